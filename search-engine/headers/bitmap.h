@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Bitmap {
+public:
+    Bitmap() = default;
+
+    explicit Bitmap(size_t size) : words_((size + kWordBits - 1) / kWordBits) {
+    }
+
+public:
+    void Resize(size_t size) {
+        words_.resize((size + kWordBits - 1) / kWordBits);
+    }
+
+    void Set(size_t index) {
+        words_[index / kWordBits] |= uint64_t{1} << (index % kWordBits);
+    }
+
+    void Reset(size_t index) {
+        words_[index / kWordBits] &= ~(uint64_t{1} << (index % kWordBits));
+    }
+
+    [[nodiscard]] bool Test(size_t index) const {
+        return (words_[index / kWordBits] >> (index % kWordBits)) & 1;
+    }
+
+    Bitmap& operator&=(const Bitmap& other) {
+        for (size_t word = 0; word < words_.size(); ++word) {
+            words_[word] &= word < other.words_.size() ? other.words_[word] : 0;
+        }
+
+        return *this;
+    }
+
+    [[nodiscard]] size_t GetMemoryUsage() const {
+        return words_.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    static constexpr size_t kWordBits = 64;
+
+private:
+    std::vector<uint64_t> words_;
+};
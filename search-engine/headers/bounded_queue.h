@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Multi-producer multi-consumer queue. Push blocks while the queue is full,
+// which throttles faster pipeline stages down to the speed of slower ones.
+template <typename Type>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {
+    }
+
+public:
+    void Push(Type value) {
+        std::unique_lock lock(mutex_);
+        is_not_full_.wait(lock, [this] {
+            return items_.size() < capacity_;
+        });
+
+        items_.push_back(std::move(value));
+        is_not_empty_.notify_one();
+    }
+
+    // Returns std::nullopt once the queue is closed and drained.
+    std::optional<Type> Pop() {
+        std::unique_lock lock(mutex_);
+        is_not_empty_.wait(lock, [this] {
+            return is_closed_ || !items_.empty();
+        });
+
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+
+        Type value = std::move(items_.front());
+        items_.pop_front();
+        is_not_full_.notify_one();
+
+        return value;
+    }
+
+    void Close() {
+        std::lock_guard lock(mutex_);
+        is_closed_ = true;
+        is_not_empty_.notify_all();
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable is_not_empty_;
+    std::condition_variable is_not_full_;
+    std::deque<Type> items_;
+    bool is_closed_ = false;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+// Bulk loader for corpus files with one document per line.
+//
+// TSV:   id <TAB> status <TAB> space separated ratings <TAB> text
+// JSONL: {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+//
+// Status is either the number of DocumentStatus or its name (ACTUAL, IRRELEVANT, BANNED, REMOVED).
+// The file is memory-mapped, split into chunks on line boundaries and pushed through
+// parse -> tokenize -> index stages connected by bounded queues. Documents are indexed
+// in file order.
+namespace corpus_loader {
+
+enum class CorpusFormat {
+    kTsv,
+    kJsonLines,
+};
+
+struct LoaderOptions {
+    CorpusFormat format = CorpusFormat::kTsv;
+    size_t chunk_size = 4 * 1024 * 1024;
+    size_t parse_thread_count = 2;
+    size_t tokenize_thread_count = 2;
+    size_t queue_capacity = 8;
+    // Chunks read but not yet indexed. Chunks are indexed in file order, so this also bounds how many of them
+    // can wait in memory behind a slow one.
+    size_t chunk_window = 32;
+};
+
+struct StageStatistics {
+    std::string name;
+    size_t thread_count = 0;
+    size_t chunk_count = 0;
+    size_t document_count = 0;
+    size_t byte_count = 0;
+    double busy_seconds = 0;
+};
+
+struct LoadReport {
+    size_t loaded_document_count = 0;
+    size_t failed_document_count = 0;
+    std::string first_error;
+    double wall_seconds = 0;
+    std::vector<StageStatistics> stages;
+};
+
+[[nodiscard]] LoadReport LoadCorpus(const std::string& path, SearchServer& search_server,
+                                    const LoaderOptions& options = {});
+
+std::ostream& operator<<(std::ostream& out, const LoadReport& report);
+
+} //namespace corpus_loader
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <optional>
+#include <vector>
 
 struct Document {
     int id = 0;
@@ -15,6 +19,28 @@ enum class DocumentStatus {
     kRemoved,
 };
 
+const size_t kDocumentStatusCount = 4;
+
+// Structured filter: evaluated on document attribute columns while postings are scored.
+struct DocumentFilter {
+    std::optional<DocumentStatus> status = std::nullopt;
+    std::optional<int> min_rating = std::nullopt;
+    std::optional<int> max_rating = std::nullopt;
+};
+
+// Limits of a bounded query. Checked between blocks of postings, so either can be overrun by one block.
+struct QueryBudget {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    size_t max_postings = SIZE_MAX;
+};
+
+struct TopDocuments {
+    std::vector<Document> documents;
+    // The budget ran out: documents are the best found among the postings scored so far.
+    bool is_partial = false;
+    size_t scored_posting_count = 0;
+};
+
 void PrintDocument(const Document& document);
 
 std::ostream& operator<<(std::ostream& out, const Document& document);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+namespace document_reordering {
+
+// Recursive graph bisection: splits the documents in two halves, swaps documents between the
+// halves while that lowers the estimated cost of delta-encoding the postings (log2 of the gaps),
+// then recurses into each half. Documents that share terms end up next to each other.
+//
+// document_terms[d] lists the terms of document d as dense IDs below term_count. Returns the
+// new order: the document at position i of the result is the i-th document of the new numbering.
+[[nodiscard]] std::vector<int> ComputeBisectionOrder(const std::vector<std::vector<int>>& document_terms,
+                                                     size_t term_count);
+
+} //namespace document_reordering
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Finds the terms of a sorted vocabulary within a given edit distance of a word
+// (insertions, deletions, substitutions and transpositions of adjacent characters).
+// The vocabulary is not scanned: after a term whose prefix can no longer be within the distance,
+// the walk seeks to the smallest string that still can, so only a small part of it is visited.
+class EditDistanceAutomaton {
+public:
+    // Words longer than this are not matched at all.
+    static constexpr size_t kMaxWordSize = 64;
+
+public:
+    EditDistanceAutomaton(std::string_view word, int max_distance);
+
+public:
+    // Cursor over terms in increasing order:
+    //     bool IsEnd() const; std::string_view GetTerm() const;
+    //     void Next(); void Seek(std::string_view term) (to the first term not less than term).
+    // Calls callback(distance) for every term within the distance while the cursor is at it.
+    template <typename Cursor, typename Callback>
+    void Walk(Cursor& cursor, Callback&& callback) {
+        if (word_.size() > kMaxWordSize) {
+            return;
+        }
+
+        std::string next_term;
+
+        while (!cursor.IsEnd()) {
+            const std::string_view term = cursor.GetTerm();
+            const size_t viable_size = Feed(term);
+
+            if (viable_size == term.size()) {
+                if (const int distance = GetRow(term.size())[word_.size()]; distance <= max_distance_) {
+                    callback(distance);
+                }
+                cursor.Next();
+            } else if (FindNextTerm(term, viable_size, next_term)) {
+                cursor.Seek(next_term);
+            } else {
+                return;
+            }
+        }
+    }
+
+private:
+    // Computes rows for the term, reusing the rows of the prefix shared with the previous term.
+    // Returns the size of the longest prefix of term that can still be extended to a match.
+    size_t Feed(std::string_view term);
+
+    // Smallest string greater than term that starts with a viable prefix, false if there is none.
+    bool FindNextTerm(std::string_view term, size_t viable_size, std::string& next_term);
+
+    // Row of distances between the first prefix_size characters of prefix_ and every prefix of the word.
+    [[nodiscard]] int* GetRow(size_t prefix_size);
+
+    // Computes the row for prefix_ of size prefix_size followed by character into row.
+    // Returns the minimum of the row.
+    int ComputeRow(size_t prefix_size, unsigned char character, int* row);
+
+private:
+    std::string word_;
+    int max_distance_;
+    // Distinct characters of the word in increasing order: only they keep a prefix viable
+    // when it is already at the maximum distance.
+    std::vector<unsigned char> word_characters_;
+
+    std::string prefix_;
+    std::vector<int> rows_;
+    std::vector<int> row_minimums_;
+    std::vector<int> candidate_row_;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+// Compile-time perfect hashing of a fixed word list (hash and displace).
+// Words are spread over buckets by a first hash, then every bucket gets its own seed
+// that places all of its words into free slots of a table twice the size of the list.
+// A lookup costs two hashes and one string comparison.
+namespace perfect_hash {
+
+constexpr uint64_t HashWord(std::string_view word, uint64_t seed) {
+    uint64_t hash = 0xCBF29CE484222325ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (const char character : word) {
+        hash ^= static_cast<uint8_t>(character);
+        hash *= 0x100000001B3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+constexpr size_t GetTableSize(size_t word_count) {
+    size_t table_size = 2;
+    while (table_size < word_count * 2) {
+        table_size *= 2;
+    }
+
+    return table_size;
+}
+
+template <size_t WordCount>
+struct Table {
+    static constexpr size_t kBucketCount = WordCount > 0 ? WordCount : 1;
+    static constexpr size_t kTableSize = GetTableSize(WordCount);
+    static constexpr uint32_t kEmptySlot = UINT32_MAX;
+
+    std::array<uint32_t, kBucketCount> bucket_seeds{};
+    std::array<uint32_t, kTableSize> slots{};
+    size_t min_word_size = SIZE_MAX;
+    size_t max_word_size = 0;
+
+    [[nodiscard]] constexpr uint32_t Find(std::string_view word) const {
+        if (word.size() < min_word_size || word.size() > max_word_size) {
+            return kEmptySlot;
+        }
+
+        const uint64_t seed = bucket_seeds[HashWord(word, 0) % kBucketCount];
+
+        return slots[HashWord(word, seed) & (kTableSize - 1)];
+    }
+};
+
+template <size_t WordCount>
+constexpr Table<WordCount> Build(const std::array<std::string_view, WordCount>& words) {
+    using TableType = Table<WordCount>;
+    constexpr size_t kBucketCount = TableType::kBucketCount;
+    constexpr size_t kMaxSeed = 1 << 20;
+
+    TableType table;
+    for (uint32_t& slot : table.slots) {
+        slot = TableType::kEmptySlot;
+    }
+
+    std::array<size_t, kBucketCount + 1> bucket_begins{};
+    std::array<uint32_t, WordCount> bucket_words{};
+    for (const std::string_view word : words) {
+        ++bucket_begins[HashWord(word, 0) % kBucketCount + 1];
+        table.min_word_size = word.size() < table.min_word_size ? word.size() : table.min_word_size;
+        table.max_word_size = word.size() > table.max_word_size ? word.size() : table.max_word_size;
+    }
+    for (size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+        bucket_begins[bucket + 1] += bucket_begins[bucket];
+    }
+
+    std::array<size_t, kBucketCount> bucket_fill{};
+    for (uint32_t index = 0; index < WordCount; ++index) {
+        const size_t bucket = HashWord(words[index], 0) % kBucketCount;
+        bucket_words[bucket_begins[bucket] + bucket_fill[bucket]++] = index;
+    }
+
+    // Largest buckets first: they are the hardest to place while the table is still empty.
+    std::array<size_t, kBucketCount> bucket_order{};
+    for (size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+        bucket_order[bucket] = bucket;
+    }
+    for (size_t left = 1; left < kBucketCount; ++left) {
+        for (size_t right = left; right > 0
+             && bucket_fill[bucket_order[right]] > bucket_fill[bucket_order[right - 1]]; --right) {
+            const size_t bucket = bucket_order[right];
+            bucket_order[right] = bucket_order[right - 1];
+            bucket_order[right - 1] = bucket;
+        }
+    }
+
+    for (const size_t bucket : bucket_order) {
+        const size_t begin = bucket_begins[bucket];
+        const size_t end = bucket_begins[bucket + 1];
+        if (begin == end) {
+            continue;
+        }
+
+        uint32_t seed = 1;
+        for (; seed < kMaxSeed; ++seed) {
+            bool is_placed = true;
+            for (size_t position = begin; position < end && is_placed; ++position) {
+                const size_t slot = HashWord(words[bucket_words[position]], seed) & (TableType::kTableSize - 1);
+                is_placed = table.slots[slot] == TableType::kEmptySlot;
+                for (size_t previous = begin; previous < position && is_placed; ++previous) {
+                    is_placed = slot != (HashWord(words[bucket_words[previous]], seed) & (TableType::kTableSize - 1));
+                }
+            }
+
+            if (is_placed) {
+                break;
+            }
+        }
+
+        if (seed == kMaxSeed) {
+            throw std::invalid_argument("Unable to build perfect hash: duplicate words?");
+        }
+
+        table.bucket_seeds[bucket] = seed;
+        for (size_t position = begin; position < end; ++position) {
+            const size_t slot = HashWord(words[bucket_words[position]], seed) & (TableType::kTableSize - 1);
+            table.slots[slot] = bucket_words[position];
+        }
+    }
+
+    return table;
+}
+
+} //namespace perfect_hash
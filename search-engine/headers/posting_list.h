@@ -0,0 +1,64 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+// Postings of one term: internal document IDs in increasing order and the term frequency
+// in each of those documents. IDs and frequencies are kept in separate arrays, so that
+// intersections only touch the IDs.
+//
+// Erased postings stay in place as tombstones with kErasedTermFreq, so erasing does not shift
+// the rest of the list; readers of the arrays skip them. They are compacted away once they are
+// a quarter of the list.
+class PostingList {
+public:
+    static constexpr double kErasedTermFreq = -1;
+
+    [[nodiscard]] static bool IsErased(double term_freq) {
+        return term_freq < 0;
+    }
+
+
+    // document_id must be greater than every ID already in the list.
+    void Append(int document_id, double term_freq);
+
+    // Inserts the document at its place or replaces its term frequency. An insertion shifts
+    // the postings up to the next tombstone, or to the end of the list if there is none.
+    void Set(int document_id, double term_freq);
+
+    // Returns false if the document is not in the list.
+    bool Erase(int document_id);
+
+    [[nodiscard]] bool Contains(int document_id) const;
+
+    [[nodiscard]] std::optional<double> FindTermFreq(int document_id) const;
+
+    // Tombstones included.
+    [[nodiscard]] const std::vector<int>& GetDocumentIds() const;
+
+    [[nodiscard]] const std::vector<double>& GetTermFreqs() const;
+
+    // Number of documents in the list, tombstones excluded.
+    [[nodiscard]] size_t GetSize() const;
+
+    [[nodiscard]] bool IsEmpty() const;
+
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+private:
+    void Compact();
+
+private:
+    std::vector<int> document_ids_;
+    std::vector<double> term_freqs_;
+    size_t erased_count_ = 0;
+};
+
+namespace posting_search {
+
+// Returns the first position not less than from at which sorted_ids[position] >= document_id,
+// or sorted_ids.size(). Gallops from `from`, so walking a long list with increasing targets
+// costs O(log distance) per target; the last few candidates are compared a SIMD block at a time.
+[[nodiscard]] size_t GallopTo(const std::vector<int>& sorted_ids, size_t from, int document_id);
+
+} //namespace posting_search
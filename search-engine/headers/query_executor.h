@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define SEARCH_ENGINE_HAS_COROUTINES 1
+#endif
+
+enum class QueryPriority {
+    kInteractive,
+    kBatch,
+};
+
+const size_t kQueryPriorityCount = 2;
+
+// Runs queries on a fixed set of threads. A query is a step function that is called again
+// and again until it returns true; a step should take a small slice of work (a block of
+// postings), so that a long batch query gives way to interactive ones between steps.
+// Interactive steps go first, but every kInteractiveStepsPerBatchStep-th step is given
+// to a batch query so that batch work still moves under constant interactive load.
+class QueryExecutor {
+public:
+    explicit QueryExecutor(size_t thread_count);
+    QueryExecutor(const QueryExecutor& other) = delete;
+    QueryExecutor& operator=(const QueryExecutor& other) = delete;
+
+    // Queued queries are run to completion before the threads stop.
+    ~QueryExecutor();
+
+public:
+    void Submit(QueryPriority priority, std::function<bool()> step);
+
+    [[nodiscard]] size_t GetThreadCount() const;
+
+    // Shared executor with one thread per core, created on first use.
+    static QueryExecutor& GetDefault();
+
+private:
+    static const size_t kInteractiveStepsPerBatchStep = 8;
+
+private:
+    void WorkerLoop();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::array<std::deque<std::function<bool()>>, kQueryPriorityCount> tasks_;
+    size_t interactive_steps_in_row_ = 0;
+    bool is_stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+template <typename Result>
+class QueryPromise;
+
+// Result of an asynchronous query. Either wait for it with Get() or, in a coroutine,
+// co_await it: the coroutine is resumed on the executor thread that completed the query.
+template <typename Result>
+class QueryFuture {
+public:
+    [[nodiscard]] bool IsReady() const {
+        std::lock_guard lock(state_->mutex);
+        return state_->is_ready;
+    }
+
+    void Wait() const {
+        std::unique_lock lock(state_->mutex);
+        state_->is_ready_condition.wait(lock, [this] {
+            return state_->is_ready;
+        });
+    }
+
+    // Waits for the query and returns its result or rethrows its exception. Can be called once.
+    [[nodiscard]] Result Get() {
+        Wait();
+
+        if (state_->exception) {
+            std::rethrow_exception(state_->exception);
+        }
+
+        return std::move(*state_->result);
+    }
+
+#ifdef SEARCH_ENGINE_HAS_COROUTINES
+    [[nodiscard]] bool await_ready() const {
+        return IsReady();
+    }
+
+    bool await_suspend(std::coroutine_handle<> continuation) {
+        std::lock_guard lock(state_->mutex);
+        if (state_->is_ready) {
+            return false;
+        }
+
+        state_->continuation = continuation;
+        return true;
+    }
+
+    Result await_resume() {
+        return Get();
+    }
+#endif
+
+private:
+    friend class QueryPromise<Result>;
+
+    struct State {
+        mutable std::mutex mutex;
+        std::condition_variable is_ready_condition;
+        bool is_ready = false;
+        std::optional<Result> result;
+        std::exception_ptr exception;
+#ifdef SEARCH_ENGINE_HAS_COROUTINES
+        std::coroutine_handle<> continuation;
+#endif
+    };
+
+private:
+    explicit QueryFuture(std::shared_ptr<State> state) : state_(std::move(state)) {
+    }
+
+private:
+    std::shared_ptr<State> state_;
+};
+
+template <typename Result>
+class QueryPromise {
+public:
+    QueryPromise() : state_(std::make_shared<State>()) {
+    }
+
+public:
+    [[nodiscard]] QueryFuture<Result> GetFuture() const {
+        return QueryFuture<Result>(state_);
+    }
+
+    void SetValue(Result result) {
+        Complete([&] {
+            state_->result.emplace(std::move(result));
+        });
+    }
+
+    void SetException(std::exception_ptr exception) {
+        Complete([&] {
+            state_->exception = std::move(exception);
+        });
+    }
+
+private:
+    using State = typename QueryFuture<Result>::State;
+
+private:
+    template <typename Store>
+    void Complete(Store store) {
+#ifdef SEARCH_ENGINE_HAS_COROUTINES
+        std::coroutine_handle<> continuation;
+#endif
+        {
+            std::lock_guard lock(state_->mutex);
+            store();
+            state_->is_ready = true;
+#ifdef SEARCH_ENGINE_HAS_COROUTINES
+            continuation = std::exchange(state_->continuation, nullptr);
+#endif
+        }
+        state_->is_ready_condition.notify_all();
+
+#ifdef SEARCH_ENGINE_HAS_COROUTINES
+        if (continuation) {
+            continuation.resume();
+        }
+#endif
+    }
+
+private:
+    std::shared_ptr<State> state_;
+};
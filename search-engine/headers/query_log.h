@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "document.h"
+
+// Compact binary log of find requests, written by RequestQueue and read by the replay tool.
+//
+// The log starts with kMagic followed by the format version byte. Every record is a sequence of
+// LEB128 varints: zigzag-encoded delta of the timestamp from the previous record, filter key,
+// result count, latency and size of the raw query, followed by the raw query bytes.
+namespace query_log {
+
+inline constexpr char kMagic[] = "SEQL";
+inline constexpr uint8_t kVersion = 1;
+
+// Filter key of a request with a custom predicate: it cannot be stored, replay uses kActual instead.
+inline constexpr uint32_t kPredicateFilterKey = kDocumentStatusCount;
+
+struct Record {
+    // Microseconds since the Unix epoch.
+    int64_t timestamp_us = 0;
+    std::string raw_query;
+    // DocumentStatus the request was filtered by or kPredicateFilterKey.
+    uint32_t filter_key = static_cast<uint32_t>(DocumentStatus::kActual);
+    uint32_t result_count = 0;
+    uint32_t latency_us = 0;
+};
+
+class Writer {
+public:
+    // Writes the header immediately. The stream must outlive the writer.
+    explicit Writer(std::ostream& output);
+
+public:
+    void Write(const Record& record);
+
+private:
+    std::ostream& output_;
+    std::string buffer_;
+    int64_t previous_timestamp_us_ = 0;
+};
+
+class Reader {
+public:
+    // Throws std::invalid_argument if the stream does not start with a query log header.
+    explicit Reader(std::istream& input);
+
+public:
+    // Returns std::nullopt at the end of the log.
+    // Throws std::invalid_argument if the last record is truncated.
+    [[nodiscard]] std::optional<Record> Read();
+
+private:
+    std::istream& input_;
+    int64_t previous_timestamp_us_ = 0;
+};
+
+} //namespace query_log
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+
+// Frame: 4-byte big-endian payload length followed by the payload.
+// Request payload starts with Operation, response payload with ResponseStatus.
+// Strings are encoded as a 4-byte length followed by raw bytes, integers are big-endian.
+namespace query_protocol {
+
+enum class Operation : uint8_t {
+    kFindTopDocuments = 1,
+    kMatchDocument = 2,
+    kAddDocument = 3,
+    kRemoveDocument = 4,
+};
+
+enum class ResponseStatus : uint8_t {
+    kOk = 0,
+    kError = 1,
+};
+
+struct Request {
+    Operation operation = Operation::kFindTopDocuments;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::kActual;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+const uint32_t kMaxFrameSize = 16 * 1024 * 1024;
+const size_t kFrameHeaderSize = 4;
+
+void AppendFrame(std::string& output, std::string_view payload);
+
+// Returns the payload size of the first complete frame in buffer, if any.
+// Throws std::invalid_argument if the announced size exceeds kMaxFrameSize.
+[[nodiscard]] std::optional<size_t> PeekFrame(std::string_view buffer);
+
+[[nodiscard]] std::string EncodeRequest(const Request& request);
+
+[[nodiscard]] Request DecodeRequest(std::string_view payload);
+
+[[nodiscard]] std::string EncodeDocuments(const std::vector<Document>& documents);
+
+[[nodiscard]] std::vector<Document> DecodeDocuments(std::string_view payload);
+
+[[nodiscard]] std::string EncodeMatchResult(const std::vector<std::string>& words, DocumentStatus status);
+
+[[nodiscard]] std::tuple<std::vector<std::string>, DocumentStatus> DecodeMatchResult(std::string_view payload);
+
+[[nodiscard]] std::string EncodeOk();
+
+[[nodiscard]] std::string EncodeError(std::string_view message);
+
+// Throws std::runtime_error with the server message if the response is an error.
+void CheckResponse(std::string_view payload);
+
+} //namespace query_protocol
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "query_protocol.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+struct QueryServerOptions {
+    std::string address = "127.0.0.1";
+    uint16_t port = 0;
+    size_t worker_count = 4;
+    size_t max_pipelined_requests = 64;
+    int listen_backlog = 4096;
+};
+
+// Serves SearchServer over the length-prefixed protocol from query_protocol.h.
+// A single epoll loop owns all sockets, requests are executed on a worker pool,
+// and responses on one connection are always written in request order.
+// Requests of one connection also take effect in order: queries may run in parallel with each other,
+// but a mutation waits for the requests before it and the requests after it wait for the mutation.
+class QueryServer {
+public:
+    QueryServer(SearchServer& search_server, const QueryServerOptions& options);
+    QueryServer(const QueryServer& other) = delete;
+    QueryServer& operator=(const QueryServer& other) = delete;
+
+    ~QueryServer();
+
+public:
+    [[nodiscard]] uint16_t GetPort() const;
+
+    // Blocks the calling thread until Stop is called.
+    void Run();
+
+    // Safe to call from any thread and from a signal handler.
+    void Stop();
+
+private:
+    struct PendingRequest {
+        uint64_t sequence = 0;
+        query_protocol::Request request;
+    };
+
+    struct Connection {
+        int socket = -1;
+        std::string input;
+        std::string output;
+        size_t output_offset = 0;
+        uint64_t next_sequence = 0;
+        uint64_t next_sequence_to_send = 0;
+        std::map<uint64_t, std::string> ready_responses;
+        // Decoded requests not yet submitted to the workers, in request order.
+        std::deque<PendingRequest> pending_requests;
+        size_t requests_in_flight = 0;
+        bool is_mutation_in_flight = false;
+        bool is_peer_closed = false;
+        uint32_t registered_events = 0;
+    };
+
+    struct Completion {
+        uint64_t connection_id = 0;
+        uint64_t sequence = 0;
+        std::string response;
+    };
+
+private:
+    static const uint64_t kListenerId = 0;
+    static const uint64_t kWakeupId = 1;
+    static const int kMaxEventsPerWait = 256;
+    static const size_t kReadChunkSize = 64 * 1024;
+
+private:
+    void AcceptConnections();
+
+    void DrainCompletions();
+
+    void HandleConnectionEvent(uint64_t connection_id, uint32_t events);
+
+    [[nodiscard]] bool ReadInput(Connection& connection);
+
+    [[nodiscard]] bool ParseRequests(Connection& connection);
+
+    // Submits pending requests of the connection as far as the order of mutations allows.
+    void SubmitRequests(uint64_t connection_id, Connection& connection);
+
+    void CollectReadyResponses(Connection& connection);
+
+    [[nodiscard]] bool WriteOutput(Connection& connection);
+
+    void UpdateInterest(uint64_t connection_id, Connection& connection);
+
+    void CloseConnection(uint64_t connection_id);
+
+    [[nodiscard]] std::string Execute(const query_protocol::Request& request);
+
+private:
+    SearchServer& search_server_;
+    std::shared_mutex search_server_mutex_;
+    const QueryServerOptions options_;
+
+    int listener_socket_ = -1;
+    // Kept open to be given up when accept runs out of descriptors, see AcceptConnections.
+    int spare_descriptor_ = -1;
+    int epoll_descriptor_ = -1;
+    int wakeup_descriptor_ = -1;
+    std::atomic<bool> is_stop_requested_ = false;
+
+    std::unordered_map<uint64_t, Connection> connections_;
+    uint64_t next_connection_id_ = kWakeupId + 1;
+
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+
+    std::unique_ptr<ThreadPool> workers_;
+};
@@ -3,6 +3,7 @@
 #include <deque>
 
 #include "document.h"
+#include "query_log.h"
 #include "search_server.h"
 
 class RequestQueue {
@@ -18,6 +19,10 @@ public:
 
     [[nodiscard]]int GetNoResultRequests() const;
 
+    // Every following request is also written to query_log, nullptr stops logging.
+    // The writer must outlive the queue or be reset.
+    void SetQueryLog(query_log::Writer* query_log);
+
 private:
     struct QueryResult {
     	std::string query;
@@ -29,6 +34,10 @@ private:
     static const int kMinutesInDay = 1440;
 
 private:
+    // Filter is a predicate or a status, passed on to FindTopDocuments as is.
+    template <typename Filter>
+    void FindAndRecord(const std::string& raw_query, Filter filter, uint32_t filter_key);
+
     void UpdateQueue(const std::string& raw_query, const std::vector<Document>& top_documents);
 
     void AddToQueue(QueryResult& query_result, const std::vector<Document>& top_documents);
@@ -39,4 +48,5 @@ private:
     std::deque<QueryResult> requests_;
     const SearchServer& server_;
     int64_t timestamp_ = 0;
+    query_log::Writer* query_log_ = nullptr;
 };
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// Kernels that add the scores of one posting list into a dense array indexed by internal document ID:
+// scores[document_ids[i]] += term_freqs[i] * weight. Blocks of scores are gathered, added to and scattered
+// back with AVX-512 (or AVX2 for float scores) when the CPU has them, otherwise one posting at a time.
+//
+// Document IDs passed to one call must be distinct, as they are within a posting list, so lanes of a block
+// never update the same score. Products and sums are rounded exactly as in the scalar code, so double
+// scores are the same on every CPU. Postings with a negative term frequency are erased ones (see posting_list.h)
+// and are skipped.
+namespace scoring_kernels {
+
+// Initial value of a score: the document has not been matched by any word yet.
+// Negative scores are taken as zero when added to.
+inline constexpr double kUnscored = -1;
+
+void AddScores(const int* document_ids, const double* term_freqs, size_t count, double weight, double* scores);
+
+// The product is computed in double and rounded to float once before it is added.
+void AddScores(const int* document_ids, const double* term_freqs, size_t count, double weight, float* scores);
+
+} //namespace scoring_kernels
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bitmap.h"
+#include "document.h"
+#include "posting_list.h"
+#include "query_executor.h"
+#include "term_dictionary.h"
+
+// How words of every document are kept besides the inverted index.
+enum class ForwardIndexMode {
+    // Word -> term frequency map per document: fastest GetWordFrequencies.
+    kWordFrequencies,
+    // Packed term IDs per document, frequencies are read back from the postings.
+    // Roughly halves the index for read-mostly deployments.
+    kTermIds,
+};
+
+// Precision of the scores of queries whose plus words have many postings: those are accumulated
+// in a dense array indexed by document (scoring_kernels.h).
+enum class ScorePrecision {
+    kDouble,
+    // Halves the array and doubles the SIMD width. Relevance of a document matched by k words may be
+    // off by up to (k + 1) * 2^-24 of its value, so documents that are almost tied may swap places.
+    kFloat,
+};
+
+// Inverted index and query evaluation. Knows nothing about how text is split into words:
+// that is done by the analyzer of BasicSearchServer (search_server.h).
+class SearchIndex {
+public:
+    // Approximate heap usage in bytes, container overhead included.
+    struct MemoryUsage {
+        size_t term_dictionary = 0;
+        size_t postings = 0;
+        size_t forward_index = 0;
+        size_t attributes = 0;
+        size_t document_ids = 0;
+
+        [[nodiscard]] size_t GetTotal() const;
+    };
+
+public:
+    SearchIndex() = default;
+    explicit SearchIndex(ForwardIndexMode forward_index_mode);
+    SearchIndex(const SearchIndex& other) = default;
+    SearchIndex& operator=(const SearchIndex& other) = default;
+
+public:
+    // Words must come from the analyzer, that is with stop words already removed. Throws
+    // std::invalid_argument if no words are left.
+    void AddDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Same as removing and adding the document again, but only postings of words that were added, removed
+    // or changed their term frequency are touched. Throws std::out_of_range for unknown documents and
+    // std::invalid_argument if no words are left.
+    void UpdateDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+                        const std::vector<int>& ratings);
+
+    // Changes status and rating without touching postings. Throws std::out_of_range for unknown documents.
+    void UpdateAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings);
+
+    [[nodiscard]] int GetDocumentCount() const;
+
+    [[nodiscard]] std::set<int>::const_iterator begin() const;
+
+    [[nodiscard]] std::set<int>::const_iterator end() const;
+
+    // Returns an empty map for unknown documents.
+    [[nodiscard]] std::map<std::string, double> GetWordFrequencies(int document_id) const;
+
+    [[nodiscard]] ForwardIndexMode GetForwardIndexMode() const;
+
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const;
+
+    // Moves recently added words into the compact term dictionary.
+    // Happens automatically while documents are added, worth calling once after a bulk load.
+    void CompactTermDictionary();
+
+    // Offline pass, e.g. after a bulk load: renumbers internal IDs so that documents with common words
+    // get close IDs (see document_reordering.h), which shortens gaps in postings and speeds up
+    // intersections. Also drops the slots of removed documents. Results do not change, except for the
+    // order of documents that tie on both relevance and rating. No query may run meanwhile.
+    void ReorderDocuments();
+
+    // Plus words that are not in the index are replaced with indexed words within this edit distance
+    // (0 turns it off, values above 2 are taken as 2). Such words count less towards relevance.
+    // Distance 1 keeps a misspelled word within a couple of milliseconds even on a 10M-term vocabulary,
+    // distance 2 reads far more of the dictionary and takes tens of milliseconds on one that large.
+    void SetMaxTypoDistance(int max_typo_distance);
+
+    void SetScorePrecision(ScorePrecision score_precision);
+
+    // Executor of asynchronous queries, QueryExecutor::GetDefault() when null. Must outlive the queries.
+    void SetQueryExecutor(QueryExecutor* query_executor);
+
+protected:
+    // A document matches if it has every required word, none of the minus words and, when there
+    // are no required words, at least one plus word. Required and plus words are scored.
+    struct Query {
+        std::set<std::string> required_words;
+        std::set<std::string> plus_words;
+        std::set<std::string> minus_words;
+        // Plus words found in place of misspelled ones -> weight of their relevance.
+        std::map<std::string, double> typo_words;
+    };
+
+    // Scores a query a block of postings at a time, so that it can be interleaved with other queries.
+    // Required words are intersected smallest list first, then plus words score only the documents
+    // that survived and minus words are subtracted from them. Without required words plus words
+    // are scored as a union.
+    // The index must not be modified until the execution is complete.
+    class QueryExecution {
+    public:
+        // Processes about max_postings postings, counting a candidate merged with a posting list as one.
+        // Returns true once the whole query is processed.
+        bool Step(size_t max_postings);
+
+        // Skips the plus words left and applies the required and minus words left to the documents
+        // scored so far, so that every one of them still matches the query.
+        void Stop();
+
+        [[nodiscard]] size_t GetScoredPostingCount() const;
+
+        // Matched documents with internal IDs, in no particular order.
+        [[nodiscard]] std::vector<Document> TakeMatchedDocuments();
+
+    private:
+        friend class SearchIndex;
+
+        enum class WordKind {
+            kRequired,
+            kPlus,
+            kMinus,
+        };
+
+        // Words are kept in this order: required, plus, minus.
+        struct Word {
+            int term_id = 0;
+            WordKind kind = WordKind::kPlus;
+            double inverse_document_freq = 0;
+        };
+
+    private:
+        [[nodiscard]] bool IsAllowed(int document_id) const;
+
+        [[nodiscard]] const PostingList& GetPostings(const Word& word) const;
+
+        // Intersects candidates with the postings of a required word, adds the scores of a required
+        // or a plus word, subtracts the postings of a minus word. Merges at most max_candidates more
+        // candidates, returns true once all of them are merged.
+        bool MergeCandidates(const Word& word, size_t max_candidates);
+
+        // Scores postings [begin, end) of a plus word into the dense scores or the map.
+        void AddScores(const Word& word, size_t begin, size_t end);
+
+        // Moves scores of the union of plus words into candidates_.
+        void CollectScores();
+
+    private:
+        const SearchIndex* index_ = nullptr;
+        std::vector<Word> words_;
+        size_t word_ = 0;
+        // Next posting of the current word. A merge also keeps the next candidate to merge and the number
+        // of candidates kept so far, the candidates in between are stale.
+        size_t posting_ = 0;
+        size_t candidate_ = 0;
+        size_t kept_count_ = 0;
+        bool is_conjunctive_ = false;
+        size_t scored_posting_count_ = 0;
+
+        const Bitmap* status_documents_ = nullptr;
+        std::optional<Bitmap> rated_documents_;
+        int min_rating_ = INT_MIN;
+        int max_rating_ = INT_MAX;
+
+        // Scores of the union of plus words. Queries with many postings use one of the dense arrays
+        // indexed by internal ID instead, they are filtered only when collected. The array is allocated
+        // by the first step that scores into it, so queries waiting in a queue do not hold one.
+        std::map<int, double> document_to_relevance_;
+        bool needs_dense_scores_ = false;
+        std::vector<double> dense_scores_;
+        std::vector<float> dense_float_scores_;
+        // Matched documents in increasing order of IDs, relevances_ go in the same order.
+        std::vector<int> candidates_;
+        std::vector<double> relevances_;
+        bool is_collected_ = false;
+    };
+
+protected:
+    // Arbitrary predicates are the fallback: they run after scoring, once per matched document.
+    template <typename Predicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const Query& query, Predicate predicate) const {
+        QueryExecution execution = StartQuery(query, DocumentFilter{});
+        execution.Step(SIZE_MAX);
+
+        return SelectTopDocuments(execution.TakeMatchedDocuments(), predicate);
+    }
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const Query& query, const DocumentFilter& filter) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const Query& query, DocumentStatus status) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const Query& query) const;
+
+    // Plus words are scored from the rarest to the most common, so that the documents
+    // found before the budget runs out are the ones that matched the most selective words.
+    [[nodiscard]] TopDocuments FindTopDocuments(const Query& query, const DocumentFilter& filter,
+                                                const QueryBudget& budget) const;
+
+    [[nodiscard]] TopDocuments FindTopDocuments(const Query& query, DocumentStatus status, const QueryBudget& budget) const;
+
+    [[nodiscard]] TopDocuments FindTopDocuments(const Query& query, const QueryBudget& budget) const;
+
+    [[nodiscard]] std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const Query& query, int document_id) const;
+
+    template <typename Predicate>
+    [[nodiscard]] QueryFuture<std::vector<Document>> FindTopDocumentsAsync(QueryPriority priority, const Query& query,
+                                                                           Predicate predicate) const {
+        return RunAsync(priority, StartQuery(query, DocumentFilter{}),
+            [this, predicate = std::move(predicate)](std::vector<Document> matched_documents) {
+                return SelectTopDocuments(std::move(matched_documents), predicate);
+            });
+    }
+
+    [[nodiscard]] QueryFuture<std::vector<Document>> FindTopDocumentsAsync(QueryPriority priority, const Query& query,
+                                                                           const DocumentFilter& filter) const;
+
+    [[nodiscard]] QueryFuture<std::vector<Document>> FindTopDocumentsAsync(QueryPriority priority, const Query& query,
+                                                                           DocumentStatus status) const;
+
+    [[nodiscard]] QueryFuture<std::vector<Document>> FindTopDocumentsAsync(QueryPriority priority, const Query& query) const;
+
+    [[nodiscard]] QueryFuture<std::tuple<std::vector<std::string>, DocumentStatus>> MatchDocumentAsync(
+        QueryPriority priority, Query query, int document_id) const;
+
+    void AddWordsWithPrefix(std::string_view prefix, std::set<std::string>& words) const;
+
+    // Does nothing if the word is indexed or typo tolerance is off.
+    void AddWordsWithTypos(std::string_view word, std::map<std::string, double>& words) const;
+
+private:
+    static const int kMaxResultDocumentCount = 5;
+    static constexpr double kCloseToZero = 1e-6;
+    static constexpr size_t kMinRecentTermsToCompact = 4096;
+    // Postings scored by one step of an asynchronous query before other queries get their turn,
+    // and between budget checks of a bounded query.
+    static constexpr size_t kPostingsPerBlock = 1024;
+    // Greater distances are lowered to this one, the walk grows too fast with the distance.
+    static constexpr int kMaxTypoDistance = 2;
+    static constexpr size_t kMaxTypoWordCount = 8;
+    // Relevance of a word found in place of a misspelled one is multiplied by this once per edit.
+    static constexpr double kTypoWeight = 0.5;
+    // Plus words are scored into a dense array once it takes at most this many bytes per posting scored into it:
+    // one posting per 64 documents with double scores, per 128 with float ones.
+    static constexpr size_t kMaxDenseScoreBytesPerPosting = 512;
+    // A rating range is turned into a bitmap only if it keeps at most 1/kSelectiveRangeDivisor of documents.
+    static constexpr size_t kSelectiveRangeDivisor = 8;
+
+private:
+    [[nodiscard]] static int ComputeAverageRating(const std::vector<int>& ratings);
+
+    // Throws std::invalid_argument if words are empty.
+    [[nodiscard]] static std::map<std::string, double> ComputeWordFrequencies(const std::vector<std::string_view>& words);
+
+    // Rewrites the term-ID forward index without stale terms once they make up more than half of it.
+    void CompactForwardIndex();
+
+    // Adds the document to or removes it from the status bitmap and the rating index.
+    void IndexAttributes(int internal_id);
+
+    void UnindexAttributes(int internal_id);
+
+    [[nodiscard]] int FindInternalId(int document_id) const;
+
+    [[nodiscard]] int FindTermId(std::string_view word) const;
+
+    [[nodiscard]] int AddTerm(std::string_view word);
+
+    [[nodiscard]] double ComputeWordInverseDocumentFrequency(int term_id) const;
+
+    // Only documents that pass the filter are scored. Plus words are scored in the order of the query
+    // unless is_selective_first is set, then from the shortest posting list to the longest.
+    [[nodiscard]] QueryExecution StartQuery(const Query& query, const DocumentFilter& filter,
+                                            bool is_selective_first = false) const;
+
+    [[nodiscard]] QueryExecutor& GetQueryExecutor() const;
+
+    // Steps the execution on the query executor and completes the future with select(matched documents).
+    template <typename Select>
+    [[nodiscard]] QueryFuture<std::vector<Document>> RunAsync(QueryPriority priority, QueryExecution execution,
+                                                              Select select) const {
+        QueryPromise<std::vector<Document>> promise;
+        QueryFuture<std::vector<Document>> future = promise.GetFuture();
+        auto query = std::make_shared<std::pair<QueryExecution, Select>>(std::move(execution), std::move(select));
+
+        GetQueryExecutor().Submit(priority, [promise, query]() mutable {
+            try {
+                if (!query->first.Step(kPostingsPerBlock)) {
+                    return false;
+                }
+                promise.SetValue(query->second(query->first.TakeMatchedDocuments()));
+            } catch (...) {
+                promise.SetException(std::current_exception());
+            }
+
+            return true;
+        });
+
+        return future;
+    }
+
+    // Sorts by relevance, keeps the best kMaxResultDocumentCount and turns internal IDs into external ones.
+    [[nodiscard]] std::vector<Document> SelectTopDocuments(std::vector<Document> matched_documents) const;
+
+    template <typename Predicate>
+    [[nodiscard]] std::vector<Document> SelectTopDocuments(std::vector<Document> matched_documents,
+                                                           Predicate& predicate) const {
+        std::vector<Document> key_matched_documents;
+
+        for (const Document& document : matched_documents) {
+            if (predicate(external_ids_[document.id], statuses_[document.id], document.rating)) {
+                key_matched_documents.push_back(document);
+            }
+        }
+
+        return SelectTopDocuments(std::move(key_matched_documents));
+    }
+
+private:
+    // Terms added since the last compaction. words[i] is the term with ID first_term_id + i, a view of a key of
+    // ids, so copies rebuild it.
+    struct TermSpan {
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    struct RecentTerms {
+        RecentTerms() = default;
+        RecentTerms(const RecentTerms& other);
+        RecentTerms(RecentTerms&& other) = default;
+        RecentTerms& operator=(const RecentTerms& other);
+        RecentTerms& operator=(RecentTerms&& other) = default;
+
+        std::map<std::string, int, std::less<>> ids;
+        std::vector<std::string_view> words;
+        int first_term_id = 0;
+    };
+
+    TermDictionary term_dictionary_;
+    RecentTerms recent_terms_;
+    // Postings and the forward index are keyed by internal document IDs: dense numbers in insertion order.
+    std::vector<PostingList> document_to_word_frequency_;
+    ForwardIndexMode forward_index_mode_ = ForwardIndexMode::kWordFrequencies;
+    // ForwardIndexMode::kWordFrequencies.
+    std::vector<std::map<std::string, double>> id_to_word_frequency_;
+    // ForwardIndexMode::kTermIds: terms of the document with internal ID i are
+    // document_terms_[offset..offset + size) of document_term_spans_[i]. Terms left behind by updates and
+    // removals are stale until CompactForwardIndex.
+    std::vector<int> document_terms_;
+    std::vector<TermSpan> document_term_spans_;
+    size_t stale_term_count_ = 0;
+
+    // Document attributes, one column per attribute, indexed by internal ID.
+    std::vector<int> external_ids_;
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    std::array<Bitmap, kDocumentStatusCount> status_documents_;
+    // Rating -> internal IDs with that rating, in no particular order.
+    std::map<int, std::vector<int>> rating_index_;
+    // Position of every document in its rating_index_ bucket, so that removing it is a swap with the last one.
+    std::vector<size_t> rating_positions_;
+
+    std::unordered_map<int, int> internal_ids_;
+    std::set<int> document_ids_;
+
+    int max_typo_distance_ = 0;
+    ScorePrecision score_precision_ = ScorePrecision::kDouble;
+    QueryExecutor* query_executor_ = nullptr;
+};
+
+std::ostream& operator<<(std::ostream& output, const SearchIndex::MemoryUsage& memory_usage);
@@ -1,126 +1,197 @@
 #pragma once
 
-#include <algorithm>
-#include <map>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "document.h"
+#include "search_index.h"
 #include "string_processing.h"
+#include "text_analyzer.h"
 
-class SearchServer {
+// Search server that turns text into words with Analyzer (see text_analyzer.h).
+// The analyzer is a template parameter, so every tenant can have its own chain
+// without paying for an indirect call per word.
+template <typename Analyzer>
+class BasicSearchServer : public SearchIndex {
 public:
-    SearchServer() = default;
-    SearchServer(const SearchServer& other) = default;
-    SearchServer& operator=(const SearchServer& other) = default;
+    BasicSearchServer() = default;
+
+    explicit BasicSearchServer(ForwardIndexMode forward_index_mode) : SearchIndex(forward_index_mode) {
+    }
 
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words)
-    : stop_words_(string_processing::StringContainerToStringSet(stop_words)) {
-	using namespace std::literals::string_literals;
+    explicit BasicSearchServer(const StringContainer& stop_words,
+                               ForwardIndexMode forward_index_mode = ForwardIndexMode::kWordFrequencies)
+        : SearchIndex(forward_index_mode), analyzer_(stop_words) {
+    }
 
-	for(const std::string& word : stop_words) {
-	    if (!CheckForSpecialSymbols(word)) {
-		throw std::invalid_argument("The word contains invalid characters."s);
-	    }
-	}
+    explicit BasicSearchServer(const std::string& stop_words_text,
+                               ForwardIndexMode forward_index_mode = ForwardIndexMode::kWordFrequencies)
+        : BasicSearchServer(string_processing::SplitIntoWords(stop_words_text), forward_index_mode) {
     }
 
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit BasicSearchServer(Analyzer analyzer,
+                               ForwardIndexMode forward_index_mode = ForwardIndexMode::kWordFrequencies)
+        : SearchIndex(forward_index_mode), analyzer_(std::move(analyzer)) {
+    }
 
 public:
-    template <typename Predicate>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::string& raw_query, Predicate predicate) const {
-        const Query query = ParseQuery(raw_query);
-
-        auto matched_documents = FindAllDocuments(query);
-
-        sort(matched_documents.begin(), matched_documents.end(),
-            [&](const Document& left_hand_side, const Document& right_hand_side) {
-                if (std::abs(left_hand_side.relevance - right_hand_side.relevance) < kCloseToZero) {
-                    return left_hand_side.rating > right_hand_side.rating;
-                } else {
-                    return left_hand_side.relevance > right_hand_side.relevance;
-                }
-	    }
-	);
-
-        std::vector<Document> key_matched_documents;
-
-        for (const Document& document : matched_documents) {
-            if (predicate(document.id, documents_.at(document.id).status, document.rating)) {
-                key_matched_documents.push_back(document);
-            }
-        }
+    using SearchIndex::AddDocument;
 
-        if (static_cast<int>(key_matched_documents.size()) > kMaxResultDocumentCount) {
-            key_matched_documents.resize(static_cast<size_t>(kMaxResultDocumentCount));
-        }
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
+        SearchIndex::AddDocument(document_id, AnalyzeDocument(document), status, ratings);
+    }
+
+    using SearchIndex::UpdateDocument;
 
-        return key_matched_documents;
+    void UpdateDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
+        SearchIndex::UpdateDocument(document_id, AnalyzeDocument(document), status, ratings);
     }
 
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+    // Only reads the analyzer, so it may run on several threads at once.
+    [[nodiscard]] std::vector<std::string_view> AnalyzeDocument(std::string_view document) const {
+        std::vector<std::string_view> words;
 
-    void RemoveDocument(int document_id);
+        analyzer_.Analyze(document, [&words](std::string_view word, bool) {
+            words.push_back(word);
+        });
 
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+        return words;
+    }
 
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+    // Accepts the same trailing arguments as SearchIndex::FindTopDocuments: nothing, a status, a DocumentFilter
+    // or a predicate. A status or a filter may be followed by a QueryBudget, then TopDocuments is returned.
+    template <typename... Args>
+    [[nodiscard]] auto FindTopDocuments(const std::string& raw_query, Args&&... args) const {
+        return SearchIndex::FindTopDocuments(ParseQuery(raw_query), std::forward<Args>(args)...);
+    }
 
-    [[nodiscard]] std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    [[nodiscard]] std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const {
+        return SearchIndex::MatchDocument(ParseQuery(raw_query), document_id);
+    }
 
-    [[nodiscard]] int GetDocumentCount() const;
+    // Asynchronous versions run on the query executor (see SetQueryExecutor) and return an awaitable
+    // QueryFuture. The query is parsed right away, so a malformed query throws here.
+    // The server must outlive the query and must not be modified until the query completes.
+    template <typename... Args>
+    [[nodiscard]] auto FindTopDocumentsAsync(QueryPriority priority, const std::string& raw_query, Args&&... args) const {
+        return SearchIndex::FindTopDocumentsAsync(priority, ParseQuery(raw_query), std::forward<Args>(args)...);
+    }
 
-    [[nodiscard]] std::set<int>::const_iterator begin() const;
+    template <typename... Args>
+    [[nodiscard]] auto FindTopDocumentsAsync(const std::string& raw_query, Args&&... args) const {
+        return FindTopDocumentsAsync(QueryPriority::kInteractive, raw_query, std::forward<Args>(args)...);
+    }
 
-    [[nodiscard]] std::set<int>::const_iterator end() const;
+    [[nodiscard]] auto MatchDocumentAsync(QueryPriority priority, const std::string& raw_query, int document_id) const {
+        return SearchIndex::MatchDocumentAsync(priority, ParseQuery(raw_query), document_id);
+    }
 
-    [[nodiscard]] const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    [[nodiscard]] auto MatchDocumentAsync(const std::string& raw_query, int document_id) const {
+        return MatchDocumentAsync(QueryPriority::kInteractive, raw_query, document_id);
+    }
 
 private:
-    struct DocumentData {
-        int rating = 0;
-        DocumentStatus status = DocumentStatus::kActual;
-    };
-
     struct QueryWord {
-        std::string data;
+        std::string_view data;
         bool is_minus = false;
+        bool is_required = false;
         bool is_stop = false;
-    };
-
-    struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+        bool is_prefix = false;
     };
 
 private:
-    static const int kMaxResultDocumentCount = 5;
-    static constexpr double kCloseToZero = 1e-6;
+    [[nodiscard]] QueryWord ParseQueryWord(std::string_view text, bool is_valid) const;
+
+    [[nodiscard]] Query ParseQuery(const std::string& text) const;
 
 private:
-    [[nodiscard]] static bool CheckForSpecialSymbols(const std::string& word);
+    Analyzer analyzer_;
+};
 
-    [[nodiscard]] bool IsStopWord(const std::string& word) const;
+template <typename Analyzer>
+typename BasicSearchServer<Analyzer>::QueryWord BasicSearchServer<Analyzer>::ParseQueryWord(std::string_view text, bool is_valid) const {
+    using namespace std::literals::string_literals;
 
-    [[nodiscard]] std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    if (text.empty()){
+        return {};
+    }
 
-    [[nodiscard]] static int ComputeAverageRating(const std::vector<int>& ratings);
+    bool is_minus = false;
+    bool is_required = false;
+    bool is_prefix = false;
 
-    [[nodiscard]] QueryWord ParseQueryWord(std::string text) const;
+    if (text[0] == '-') {
+	is_minus = true;
+	text.remove_prefix(1);
+    } else if (text[0] == '+') {
+	is_required = true;
+	text.remove_prefix(1);
+    }
 
-    [[nodiscard]] Query ParseQuery(const std::string& text) const;
+    if (text.size() > 1 && text.back() == '*') {
+	is_prefix = true;
+	text.remove_suffix(1);
+    }
 
-    [[nodiscard]] double ComputeWordInverseDocumentFrequency(const std::string& word) const;
+    if (text.empty()) {
+	throw std::invalid_argument(is_required ? "No text after \"plus\" character."s : "No text after \"minus\" character."s);
+    } else if (text[0] == '+') {
+	throw std::invalid_argument("Plus after minus or more than one plus in the start of the word."s);
+    } else if (is_required && is_prefix) {
+	throw std::invalid_argument("Prefix words cannot be required."s);
+    } else if (text == "*") {
+	throw std::invalid_argument("No text before \"*\" character."s);
+    } else if ((text[0] == '-') || (text[text.size() - 1] == '-')) {
+	throw std::invalid_argument("Minus in the end of the word or more than one minus in the start of the word."s);
+    } else if (!is_valid) {
+	throw std::invalid_argument("The word contains invalid characters"s);
+    }
 
-    [[nodiscard]] std::vector<Document> FindAllDocuments(const Query& query) const;
+    return {text, is_minus, is_required, !is_prefix && analyzer_.IsStopWord(text), is_prefix};
+}
 
-private:
-    std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> document_to_word_frequency_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string, double>> id_to_word_frequency_;
-};
+template <typename Analyzer>
+SearchIndex::Query BasicSearchServer<Analyzer>::ParseQuery(const std::string& text) const {
+    Query query;
+
+    analyzer_.Tokenize(text, [&](std::string_view word, bool is_valid) {
+        const QueryWord query_word = ParseQueryWord(word, is_valid);
+
+        if (query_word.is_stop) {
+            return;
+        }
+
+        std::set<std::string>& words = query_word.is_minus ? query.minus_words
+                                     : query_word.is_required ? query.required_words : query.plus_words;
+        if (query_word.is_prefix) {
+            AddWordsWithPrefix(query_word.data, words);
+        } else {
+            words.emplace(query_word.data);
+        }
+
+        if (!query_word.is_minus && !query_word.is_required && !query_word.is_prefix) {
+            AddWordsWithTypos(query_word.data, query.typo_words);
+        }
+    });
+
+    for (const std::string& word : query.required_words) {
+        query.plus_words.erase(word);
+        query.typo_words.erase(word);
+    }
+
+    for (const std::string& word : query.plus_words) {
+        query.typo_words.erase(word);
+    }
+
+    return query;
+}
+
+using SearchServer = BasicSearchServer<DefaultAnalyzer>;
+
+extern template class BasicSearchServer<DefaultAnalyzer>;
@@ -1,23 +1,13 @@
 #pragma once
 
-#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace string_processing {
 
 std::vector<std::string> SplitIntoWords(const std::string& text);
 
-template <typename StringContainer>
-std::set<std::string> StringContainerToStringSet(const StringContainer& string_container) {
-	std::set<std::string> set_of_strings;
-    for (const std::string& word : string_container) {
-        if (!word.empty()) {
-            set_of_strings.insert(word);
-        }
-    }
-
-    return set_of_strings;
-}
+std::vector<std::string_view> SplitIntoWordViews(std::string_view text);
 
 } //namespace string_processing
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable sorted dictionary mapping words to term IDs.
+// Terms are front-coded in blocks of kBlockSize: every block starts with a full term,
+// the following terms store only the length of the prefix shared with the previous term
+// and the remaining suffix. Lookup is a binary search over block heads followed by
+// a short scan inside one block, prefix enumeration walks the blocks in order.
+class TermDictionary {
+public:
+    class Builder;
+    class Iterator;
+
+public:
+    static constexpr int kNotFound = -1;
+
+public:
+    TermDictionary() = default;
+
+public:
+    [[nodiscard]] int Find(std::string_view term) const;
+
+    // Positions the iterator at the first term that is not less than term.
+    [[nodiscard]] Iterator LowerBound(std::string_view term) const;
+
+    [[nodiscard]] Iterator begin() const;
+
+    [[nodiscard]] bool ContainsTermId(int term_id) const;
+
+    [[nodiscard]] std::string GetTerm(int term_id) const;
+
+    [[nodiscard]] size_t GetTermCount() const;
+
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+private:
+    static constexpr size_t kBlockSize = 16;
+    static constexpr uint32_t kNoOrdinal = UINT32_MAX;
+
+private:
+    [[nodiscard]] std::string_view GetBlockHead(size_t block) const;
+
+private:
+    std::string data_;
+    std::vector<uint64_t> block_offsets_;
+    std::vector<uint32_t> term_id_to_ordinal_;
+    size_t term_count_ = 0;
+};
+
+// Accepts terms in strictly increasing order.
+class TermDictionary::Builder {
+public:
+    void Add(std::string_view term, int term_id);
+
+    [[nodiscard]] TermDictionary Build();
+
+private:
+    TermDictionary dictionary_;
+    std::string previous_term_;
+};
+
+class TermDictionary::Iterator {
+public:
+    [[nodiscard]] bool IsEnd() const;
+
+    [[nodiscard]] std::string_view GetTerm() const;
+
+    [[nodiscard]] int GetTermId() const;
+
+    void Next();
+
+private:
+    friend class TermDictionary;
+
+    Iterator(const TermDictionary& dictionary, size_t block);
+
+    void Decode();
+
+private:
+    const TermDictionary* dictionary_;
+    size_t ordinal_ = 0;
+    size_t position_ = 0;
+    std::string term_;
+    int term_id_ = kNotFound;
+};
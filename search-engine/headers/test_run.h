@@ -7,3 +7,15 @@ void RunPaginator();
 void RunEmptyRequests();
 
 void RunRemoveDuplicates();
+
+void RunBoundedRequiredWords();
+
+void RunResumedQueries();
+
+void RunUpdateDocuments();
+
+void RunReorderDocuments();
+
+void RunTypoExpansion();
+
+void RunQueryProtocol();
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "perfect_hash.h"
+
+// Building blocks of Analyzer<Tokenizer, Validator, Filter>.
+//
+// Tokenizer: static constexpr bool IsDelimiter(char character)
+// Validator: static constexpr bool IsValidCharacter(char character)
+// Filter:    bool IsStopWord(std::string_view word) const
+//
+// Everything is resolved at compile time, so Analyze walks the text once and calls
+// no virtual functions: delimiters, character validation and stop word lookups happen
+// in the same loop.
+
+struct SpaceTokenizer {
+    static constexpr bool IsDelimiter(char character) {
+        return character == ' ';
+    }
+};
+
+struct ControlCharValidator {
+    static constexpr bool IsValidCharacter(char character) {
+        return !(character >= '\0' && character <= ' ');
+    }
+};
+
+struct NoValidation {
+    static constexpr bool IsValidCharacter(char) {
+        return true;
+    }
+};
+
+struct NoStopWords {
+    [[nodiscard]] bool IsStopWord(std::string_view) const {
+        return false;
+    }
+};
+
+// Stop words known only at run time.
+class RuntimeStopWords {
+public:
+    RuntimeStopWords() = default;
+
+    template <typename StringContainer>
+    explicit RuntimeStopWords(const StringContainer& stop_words) {
+        for (const auto& word : stop_words) {
+            if (!std::string_view(word).empty()) {
+                words_.emplace(word);
+            }
+        }
+    }
+
+public:
+    [[nodiscard]] bool Contains(std::string_view word) const {
+        return words_.find(word) != words_.end();
+    }
+
+private:
+    struct WordHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view word) const {
+            return std::hash<std::string_view>{}(word);
+        }
+    };
+
+private:
+    std::unordered_set<std::string, WordHash, std::equal_to<>> words_;
+};
+
+// Stop words known at build time, looked up through a perfect hash computed by the compiler:
+//     inline constexpr std::array kStopWords{"and"sv, "in"sv, "on"sv};
+//     using Filter = StopWordFilter<StaticStopWords<kStopWords>>;
+template <const auto& kWords>
+class StaticStopWords {
+public:
+    [[nodiscard]] bool Contains(std::string_view word) const {
+        const uint32_t slot = kTable.Find(word);
+
+        return slot != kTable.kEmptySlot && kWords[slot] == word;
+    }
+
+private:
+    static constexpr auto kTable = perfect_hash::Build(kWords);
+};
+
+template <typename StopWordSet>
+class StopWordFilter {
+public:
+    StopWordFilter() = default;
+
+    template <typename StringContainer>
+    explicit StopWordFilter(const StringContainer& stop_words) : stop_words_(stop_words) {
+    }
+
+public:
+    [[nodiscard]] bool IsStopWord(std::string_view word) const {
+        return stop_words_.Contains(word);
+    }
+
+private:
+    StopWordSet stop_words_;
+};
+
+template <typename Tokenizer, typename Validator, typename Filter>
+class Analyzer {
+public:
+    Analyzer() = default;
+
+    // Every stop word is checked by the validator.
+    template <typename StringContainer>
+    explicit Analyzer(const StringContainer& stop_words) : filter_(CheckStopWords(stop_words)) {
+    }
+
+public:
+    // Calls sink(word, is_valid) for every word of the text that is not a stop word.
+    template <typename Sink>
+    void Analyze(std::string_view text, Sink&& sink) const {
+        Tokenize(text, [&](std::string_view word, bool is_valid) {
+            if (!filter_.IsStopWord(word)) {
+                sink(word, is_valid);
+            }
+        });
+    }
+
+    // Calls sink(word, is_valid) for every word of the text, stop words included.
+    template <typename Sink>
+    void Tokenize(std::string_view text, Sink&& sink) const {
+        size_t word_begin = 0;
+        bool is_valid = true;
+
+        for (size_t position = 0; position < text.size(); ++position) {
+            const char character = text[position];
+
+            if (Tokenizer::IsDelimiter(character)) {
+                sink(text.substr(word_begin, position - word_begin), is_valid);
+                word_begin = position + 1;
+                is_valid = true;
+            } else {
+                is_valid &= Validator::IsValidCharacter(character);
+            }
+        }
+
+        sink(text.substr(word_begin), is_valid);
+    }
+
+    [[nodiscard]] bool IsStopWord(std::string_view word) const {
+        return filter_.IsStopWord(word);
+    }
+
+    [[nodiscard]] static bool IsValidWord(std::string_view word) {
+        for (const char character : word) {
+            if (!Validator::IsValidCharacter(character)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    template <typename StringContainer>
+    static const StringContainer& CheckStopWords(const StringContainer& stop_words) {
+        using namespace std::literals::string_literals;
+
+        for (const auto& word : stop_words) {
+            if (!IsValidWord(word)) {
+                throw std::invalid_argument("The word contains invalid characters."s);
+            }
+        }
+
+        return stop_words;
+    }
+
+private:
+    Filter filter_;
+};
+
+using DefaultAnalyzer = Analyzer<SpaceTokenizer, ControlCharValidator, StopWordFilter<RuntimeStopWords>>;
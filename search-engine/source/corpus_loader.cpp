@@ -0,0 +1,655 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "bounded_queue.h"
+#include "corpus_loader.h"
+#include "string_processing.h"
+
+using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    ~MappedFile();
+
+public:
+    [[nodiscard]] std::string_view GetContents() const;
+
+private:
+#if defined(__unix__) || defined(__APPLE__)
+    void* data_ = nullptr;
+    size_t size_ = 0;
+#else
+    std::string contents_;
+#endif
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+
+MappedFile::MappedFile(const std::string& path) {
+    const int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::runtime_error("Unable to open corpus file "s + path);
+    }
+
+    struct stat file_status{};
+    if (fstat(descriptor, &file_status) < 0) {
+        close(descriptor);
+        throw std::runtime_error("Unable to stat corpus file "s + path);
+    }
+
+    size_ = static_cast<size_t>(file_status.st_size);
+    if (size_ > 0) {
+        data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            close(descriptor);
+            throw std::runtime_error("Unable to map corpus file "s + path);
+        }
+        madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+
+    close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+std::string_view MappedFile::GetContents() const {
+    return {static_cast<const char*>(data_), size_};
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Unable to open corpus file "s + path);
+    }
+
+    contents_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+MappedFile::~MappedFile() = default;
+
+std::string_view MappedFile::GetContents() const {
+    return contents_;
+}
+
+#endif
+
+struct Chunk {
+    size_t sequence = 0;
+    std::string_view text;
+};
+
+struct ParsedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::kActual;
+    std::vector<int> ratings;
+    std::string_view text;
+    std::vector<std::string_view> words;
+};
+
+struct ParsedChunk {
+    size_t sequence = 0;
+    size_t byte_count = 0;
+    std::vector<ParsedDocument> documents;
+    // Owns texts that had to be unescaped; std::deque keeps them in place while it grows.
+    std::deque<std::string> unescaped_texts;
+    size_t failed_document_count = 0;
+    std::string first_error;
+};
+
+int ParseInt(std::string_view text) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid integer: "s + std::string(text));
+    }
+
+    return value;
+}
+
+DocumentStatus ParseStatus(std::string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::kActual;
+    } else if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::kIrrelevant;
+    } else if (text == "BANNED"sv) {
+        return DocumentStatus::kBanned;
+    } else if (text == "REMOVED"sv) {
+        return DocumentStatus::kRemoved;
+    }
+
+    const int status = ParseInt(text);
+    if (status < 0 || status > static_cast<int>(DocumentStatus::kRemoved)) {
+        throw std::invalid_argument("Invalid document status: "s + std::string(text));
+    }
+
+    return static_cast<DocumentStatus>(status);
+}
+
+ParsedDocument ParseTsvLine(std::string_view line) {
+    std::string_view fields[3];
+
+    for (std::string_view& field : fields) {
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) {
+            throw std::invalid_argument("Expected 4 tab separated fields."s);
+        }
+        field = line.substr(0, tab);
+        line.remove_prefix(tab + 1);
+    }
+
+    ParsedDocument document;
+    document.id = ParseInt(fields[0]);
+    document.status = ParseStatus(fields[1]);
+    document.text = line;
+
+    for (const std::string_view rating : string_processing::SplitIntoWordViews(fields[2])) {
+        if (!rating.empty()) {
+            document.ratings.push_back(ParseInt(rating));
+        }
+    }
+
+    return document;
+}
+
+void AppendUtf8(std::string& output, uint32_t code_point) {
+    if (code_point < 0x80) {
+        output.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        output.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        output.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        output.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        output.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+// Parses flat JSON objects; values of unknown keys are skipped.
+class JsonLineParser {
+public:
+    JsonLineParser(std::string_view line, std::deque<std::string>& unescaped_texts)
+        : line_(line)
+        , unescaped_texts_(unescaped_texts) {
+    }
+
+    ParsedDocument Parse() {
+        ParsedDocument document;
+        bool has_id = false;
+        bool has_text = false;
+
+        Expect('{');
+        if (!TryConsume('}')) {
+            do {
+                const std::string_view key = ReadString();
+                Expect(':');
+
+                if (key == "id"sv) {
+                    document.id = ParseInt(ReadNumber());
+                    has_id = true;
+                } else if (key == "status"sv) {
+                    document.status = ParseStatus(PeekCharacter() == '"' ? ReadString() : ReadNumber());
+                } else if (key == "ratings"sv) {
+                    Expect('[');
+                    if (!TryConsume(']')) {
+                        do {
+                            document.ratings.push_back(ParseInt(ReadNumber()));
+                        } while (TryConsume(','));
+                        Expect(']');
+                    }
+                } else if (key == "text"sv) {
+                    document.text = ReadString();
+                    has_text = true;
+                } else {
+                    SkipValue();
+                }
+            } while (TryConsume(','));
+            Expect('}');
+        }
+
+        SkipWhitespace();
+        if (position_ != line_.size()) {
+            throw std::invalid_argument("Unexpected characters after JSON object."s);
+        }
+        if (!has_id || !has_text) {
+            throw std::invalid_argument("JSON document must have \"id\" and \"text\"."s);
+        }
+
+        return document;
+    }
+
+private:
+    void SkipWhitespace() {
+        while (position_ < line_.size()
+            && (line_[position_] == ' ' || line_[position_] == '\t' || line_[position_] == '\r')) {
+            ++position_;
+        }
+    }
+
+    char PeekCharacter() {
+        SkipWhitespace();
+        if (position_ == line_.size()) {
+            throw std::invalid_argument("Unexpected end of JSON line."s);
+        }
+
+        return line_[position_];
+    }
+
+    bool TryConsume(char character) {
+        if (PeekCharacter() == character) {
+            ++position_;
+            return true;
+        }
+
+        return false;
+    }
+
+    void Expect(char character) {
+        if (!TryConsume(character)) {
+            throw std::invalid_argument("Expected '"s + character + "' in JSON line."s);
+        }
+    }
+
+    std::string_view ReadNumber() {
+        PeekCharacter();
+        const size_t begin = position_;
+        while (position_ < line_.size() && line_[position_] != ',' && line_[position_] != ']'
+            && line_[position_] != '}' && line_[position_] != ' ' && line_[position_] != '\t') {
+            ++position_;
+        }
+
+        return line_.substr(begin, position_ - begin);
+    }
+
+    std::string_view ReadString() {
+        Expect('"');
+        const size_t begin = position_;
+
+        while (position_ < line_.size() && line_[position_] != '"') {
+            if (line_[position_] == '\\') {
+                return ReadEscapedString(begin);
+            }
+            ++position_;
+        }
+        Expect('"');
+
+        return line_.substr(begin, position_ - begin - 1);
+    }
+
+    std::string_view ReadEscapedString(size_t begin) {
+        std::string& text = unescaped_texts_.emplace_back(line_.substr(begin, position_ - begin));
+
+        while (position_ < line_.size() && line_[position_] != '"') {
+            if (line_[position_] != '\\') {
+                text.push_back(line_[position_++]);
+                continue;
+            }
+
+            if (++position_ == line_.size()) {
+                break;
+            }
+
+            const char escaped = line_[position_++];
+            switch (escaped) {
+            case 'n':
+                text.push_back('\n');
+                break;
+            case 't':
+                text.push_back('\t');
+                break;
+            case 'r':
+                text.push_back('\r');
+                break;
+            case 'b':
+                text.push_back('\b');
+                break;
+            case 'f':
+                text.push_back('\f');
+                break;
+            case 'u': {
+                uint32_t code_point = ReadHexQuad();
+                if (code_point >= 0xD800 && code_point < 0xDC00 && line_.substr(position_, 2) == "\\u"sv) {
+                    position_ += 2;
+                    const uint32_t low_surrogate = ReadHexQuad();
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                }
+                AppendUtf8(text, code_point);
+                break;
+            }
+            default:
+                text.push_back(escaped);
+            }
+        }
+        Expect('"');
+
+        return text;
+    }
+
+    uint32_t ReadHexQuad() {
+        if (line_.size() - position_ < 4) {
+            throw std::invalid_argument("Truncated \\u escape in JSON line."s);
+        }
+
+        uint32_t value = 0;
+        const auto [end, error] = std::from_chars(line_.data() + position_, line_.data() + position_ + 4, value, 16);
+        if (error != std::errc() || end != line_.data() + position_ + 4) {
+            throw std::invalid_argument("Invalid \\u escape in JSON line."s);
+        }
+        position_ += 4;
+
+        return value;
+    }
+
+    void SkipValue() {
+        const char first = PeekCharacter();
+
+        if (first == '"') {
+            ReadString();
+        } else if (first == '[' || first == '{') {
+            const char closing = first == '[' ? ']' : '}';
+            ++position_;
+            if (!TryConsume(closing)) {
+                do {
+                    if (first == '{') {
+                        ReadString();
+                        Expect(':');
+                    }
+                    SkipValue();
+                } while (TryConsume(','));
+                Expect(closing);
+            }
+        } else {
+            ReadNumber();
+        }
+    }
+
+private:
+    std::string_view line_;
+    size_t position_ = 0;
+    std::deque<std::string>& unescaped_texts_;
+};
+
+ParsedChunk ParseChunk(const Chunk& chunk, corpus_loader::CorpusFormat format) {
+    ParsedChunk parsed_chunk;
+    parsed_chunk.sequence = chunk.sequence;
+    parsed_chunk.byte_count = chunk.text.size();
+
+    std::string_view text = chunk.text;
+
+    while (!text.empty()) {
+        const size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        try {
+            if (format == corpus_loader::CorpusFormat::kTsv) {
+                parsed_chunk.documents.push_back(ParseTsvLine(line));
+            } else {
+                parsed_chunk.documents.push_back(JsonLineParser(line, parsed_chunk.unescaped_texts).Parse());
+            }
+        } catch (const std::invalid_argument& e) {
+            if (parsed_chunk.failed_document_count++ == 0) {
+                parsed_chunk.first_error = e.what();
+            }
+        }
+    }
+
+    return parsed_chunk;
+}
+
+// Keeps the reader at most size chunks ahead of the index stage.
+class ChunkWindow {
+public:
+    explicit ChunkWindow(size_t size) : size_(size > 0 ? size : 1) {
+    }
+
+public:
+    void WaitForSlot(size_t sequence) {
+        std::unique_lock lock(mutex_);
+        has_slot_.wait(lock, [this, sequence] {
+            return sequence < indexed_count_ + size_;
+        });
+    }
+
+    void MarkIndexed() {
+        std::lock_guard lock(mutex_);
+        ++indexed_count_;
+        has_slot_.notify_one();
+    }
+
+private:
+    const size_t size_;
+    std::mutex mutex_;
+    std::condition_variable has_slot_;
+    size_t indexed_count_ = 0;
+};
+
+double SecondsSince(Clock::time_point start_time) {
+    return std::chrono::duration<double>(Clock::now() - start_time).count();
+}
+
+void MergeStatistics(corpus_loader::StageStatistics& total, const corpus_loader::StageStatistics& part,
+                     std::mutex& mutex) {
+    std::lock_guard lock(mutex);
+    total.chunk_count += part.chunk_count;
+    total.document_count += part.document_count;
+    total.byte_count += part.byte_count;
+    total.busy_seconds += part.busy_seconds;
+}
+
+} //namespace
+
+corpus_loader::LoadReport corpus_loader::LoadCorpus(const std::string& path, SearchServer& search_server,
+                                                    const LoaderOptions& options) {
+    const Clock::time_point load_start_time = Clock::now();
+    const MappedFile file(path);
+    const std::string_view contents = file.GetContents();
+
+    StageStatistics read_statistics{"read"s, 1};
+    StageStatistics parse_statistics{"parse"s, std::max<size_t>(options.parse_thread_count, 1)};
+    StageStatistics tokenize_statistics{"tokenize"s, std::max<size_t>(options.tokenize_thread_count, 1)};
+    StageStatistics index_statistics{"index"s, 1};
+    std::mutex statistics_mutex;
+
+    BoundedQueue<Chunk> chunks(options.queue_capacity);
+    BoundedQueue<ParsedChunk> parsed_chunks(options.queue_capacity);
+    BoundedQueue<ParsedChunk> tokenized_chunks(options.queue_capacity);
+    ChunkWindow chunk_window(options.chunk_window);
+
+    std::thread reader([&] {
+        const size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+        size_t sequence = 0;
+
+        for (size_t begin = 0; begin < contents.size();) {
+            chunk_window.WaitForSlot(sequence);
+
+            const Clock::time_point start_time = Clock::now();
+            size_t end = std::min(begin + chunk_size, contents.size());
+            const size_t newline = contents.find('\n', end - 1);
+            end = newline == std::string_view::npos ? contents.size() : newline + 1;
+            read_statistics.busy_seconds += SecondsSince(start_time);
+
+            chunks.Push({sequence++, contents.substr(begin, end - begin)});
+            begin = end;
+        }
+        chunks.Close();
+
+        read_statistics.chunk_count = sequence;
+        read_statistics.byte_count = contents.size();
+    });
+
+    std::vector<std::thread> parsers;
+    for (size_t index = 0; index < parse_statistics.thread_count; ++index) {
+        parsers.emplace_back([&] {
+            StageStatistics statistics;
+            while (std::optional<Chunk> chunk = chunks.Pop()) {
+                const Clock::time_point start_time = Clock::now();
+                ParsedChunk parsed_chunk = ParseChunk(*chunk, options.format);
+                ++statistics.chunk_count;
+                statistics.document_count += parsed_chunk.documents.size();
+                statistics.byte_count += parsed_chunk.byte_count;
+                statistics.busy_seconds += SecondsSince(start_time);
+
+                parsed_chunks.Push(std::move(parsed_chunk));
+            }
+            MergeStatistics(parse_statistics, statistics, statistics_mutex);
+        });
+    }
+
+    std::vector<std::thread> tokenizers;
+    for (size_t index = 0; index < tokenize_statistics.thread_count; ++index) {
+        tokenizers.emplace_back([&] {
+            StageStatistics statistics;
+            while (std::optional<ParsedChunk> chunk = parsed_chunks.Pop()) {
+                const Clock::time_point start_time = Clock::now();
+                statistics.document_count += chunk->documents.size();
+                // Documents of nothing but stop words are rejected here, the index would refuse them anyway.
+                std::erase_if(chunk->documents, [&](ParsedDocument& document) {
+                    document.words = search_server.AnalyzeDocument(document.text);
+                    if (!document.words.empty()) {
+                        return false;
+                    }
+                    if (chunk->failed_document_count++ == 0) {
+                        chunk->first_error = "The document has no words other than stop words."s;
+                    }
+                    return true;
+                });
+                ++statistics.chunk_count;
+                statistics.byte_count += chunk->byte_count;
+                statistics.busy_seconds += SecondsSince(start_time);
+
+                tokenized_chunks.Push(std::move(*chunk));
+            }
+            MergeStatistics(tokenize_statistics, statistics, statistics_mutex);
+        });
+    }
+
+    std::thread parse_closer([&] {
+        for (std::thread& parser : parsers) {
+            parser.join();
+        }
+        parsed_chunks.Close();
+
+        for (std::thread& tokenizer : tokenizers) {
+            tokenizer.join();
+        }
+        tokenized_chunks.Close();
+    });
+
+    LoadReport report;
+    std::map<size_t, ParsedChunk> pending_chunks;
+    size_t next_sequence = 0;
+
+    while (std::optional<ParsedChunk> chunk = tokenized_chunks.Pop()) {
+        pending_chunks.emplace(chunk->sequence, std::move(*chunk));
+
+        for (auto pending = pending_chunks.begin();
+             pending != pending_chunks.end() && pending->first == next_sequence;
+             pending = pending_chunks.erase(pending), ++next_sequence) {
+            const Clock::time_point start_time = Clock::now();
+            ParsedChunk& ready_chunk = pending->second;
+
+            if (ready_chunk.failed_document_count > 0 && report.first_error.empty()) {
+                report.first_error = ready_chunk.first_error;
+            }
+            report.failed_document_count += ready_chunk.failed_document_count;
+
+            for (const ParsedDocument& document : ready_chunk.documents) {
+                try {
+                    search_server.AddDocument(document.id, document.words, document.status, document.ratings);
+                    ++report.loaded_document_count;
+                } catch (const std::exception& e) {
+                    if (report.failed_document_count++ == 0) {
+                        report.first_error = e.what();
+                    }
+                }
+            }
+
+            ++index_statistics.chunk_count;
+            index_statistics.document_count += ready_chunk.documents.size();
+            index_statistics.byte_count += ready_chunk.byte_count;
+            index_statistics.busy_seconds += SecondsSince(start_time);
+            chunk_window.MarkIndexed();
+        }
+    }
+
+    reader.join();
+    parse_closer.join();
+
+    search_server.CompactTermDictionary();
+
+    report.wall_seconds = SecondsSince(load_start_time);
+    report.stages = {read_statistics, parse_statistics, tokenize_statistics, index_statistics};
+
+    return report;
+}
+
+std::ostream& corpus_loader::operator<<(std::ostream& out, const LoadReport& report) {
+    out << "loaded = "s << report.loaded_document_count << ", "s
+        << "failed = "s << report.failed_document_count << ", "s
+        << "wall = "s << report.wall_seconds << " s"s << std::endl;
+
+    if (!report.first_error.empty()) {
+        out << "first error: "s << report.first_error << std::endl;
+    }
+
+    for (const StageStatistics& stage : report.stages) {
+        const double busy_seconds = stage.busy_seconds > 0 ? stage.busy_seconds : 1e-9;
+        const double thread_count = static_cast<double>(std::max<size_t>(stage.thread_count, 1));
+
+        out << stage.name << ": "s
+            << "threads = "s << stage.thread_count << ", "s
+            << "chunks = "s << stage.chunk_count << ", "s
+            << "busy = "s << std::fixed << std::setprecision(3) << stage.busy_seconds << " s, "s
+            << std::setprecision(1) << stage.byte_count / busy_seconds * thread_count / (1024 * 1024) << " MB/s, "s
+            << stage.document_count / busy_seconds * thread_count << " docs/s"s
+            << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+
+    return out;
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "document_reordering.h"
+
+namespace {
+
+const size_t kMinBisectionSize = 16;
+const int kMaxBisectionDepth = 40;
+const int kIterationsPerBisection = 20;
+
+class GraphBisection {
+public:
+    GraphBisection(const std::vector<std::vector<int>>& document_terms, size_t term_count)
+        : document_terms_(document_terms),
+          degrees_{std::vector<int>(term_count), std::vector<int>(term_count)},
+          term_gains_{std::vector<double>(term_count), std::vector<double>(term_count)},
+          document_gains_(document_terms.size()) {
+    }
+
+public:
+    void Bisect(std::vector<int>::iterator begin, std::vector<int>::iterator end, int depth) {
+        const size_t size = static_cast<size_t>(end - begin);
+        if (size < kMinBisectionSize || depth >= kMaxBisectionDepth) {
+            return;
+        }
+
+        const auto middle = begin + size / 2;
+
+        for (int iteration = 0; iteration < kIterationsPerBisection; ++iteration) {
+            ComputeGains(begin, middle, end);
+
+            const auto by_gain = [this](int left_hand_side, int right_hand_side) {
+                return document_gains_[left_hand_side] > document_gains_[right_hand_side];
+            };
+            std::sort(begin, middle, by_gain);
+            std::sort(middle, end, by_gain);
+
+            size_t swap_count = 0;
+            for (auto left = begin, right = middle; left != middle && right != end; ++left, ++right) {
+                if (document_gains_[*left] + document_gains_[*right] <= 0) {
+                    break;
+                }
+                std::iter_swap(left, right);
+                ++swap_count;
+            }
+
+            if (swap_count == 0) {
+                break;
+            }
+        }
+
+        Bisect(begin, middle, depth + 1);
+        Bisect(middle, end, depth + 1);
+    }
+
+private:
+    // Estimated bits of the postings of a term with degree documents in a part of part_size documents.
+    static double GetCost(int degree, size_t part_size) {
+        return degree * std::log2(static_cast<double>(part_size) / (degree + 1));
+    }
+
+    void CountDegrees(std::vector<int>::iterator begin, std::vector<int>::iterator end, size_t part) {
+        for (auto document = begin; document != end; ++document) {
+            for (const int term : document_terms_[*document]) {
+                if (degrees_[0][term] == 0 && degrees_[1][term] == 0) {
+                    touched_terms_.push_back(term);
+                }
+                ++degrees_[part][term];
+            }
+        }
+    }
+
+    void ComputeGains(std::vector<int>::iterator begin, std::vector<int>::iterator middle,
+                      std::vector<int>::iterator end) {
+        const size_t part_sizes[2] = {static_cast<size_t>(middle - begin), static_cast<size_t>(end - middle)};
+
+        CountDegrees(begin, middle, 0);
+        CountDegrees(middle, end, 1);
+
+        // Gain of moving one document with the term from a part to the other one.
+        for (const int term : touched_terms_) {
+            for (size_t from = 0; from < 2; ++from) {
+                const size_t to = 1 - from;
+                const int from_degree = degrees_[from][term];
+                const int to_degree = degrees_[to][term];
+
+                term_gains_[from][term] = from_degree == 0 ? 0
+                    : GetCost(from_degree, part_sizes[from]) + GetCost(to_degree, part_sizes[to])
+                      - GetCost(from_degree - 1, part_sizes[from]) - GetCost(to_degree + 1, part_sizes[to]);
+            }
+        }
+
+        for (auto document = begin; document != end; ++document) {
+            const size_t part = document < middle ? 0 : 1;
+            double gain = 0;
+            for (const int term : document_terms_[*document]) {
+                gain += term_gains_[part][term];
+            }
+            document_gains_[*document] = gain;
+        }
+
+        for (const int term : touched_terms_) {
+            degrees_[0][term] = 0;
+            degrees_[1][term] = 0;
+        }
+        touched_terms_.clear();
+    }
+
+private:
+    const std::vector<std::vector<int>>& document_terms_;
+    std::vector<int> degrees_[2];
+    std::vector<double> term_gains_[2];
+    std::vector<double> document_gains_;
+    std::vector<int> touched_terms_;
+};
+
+} //namespace
+
+std::vector<int> document_reordering::ComputeBisectionOrder(const std::vector<std::vector<int>>& document_terms,
+                                                            size_t term_count) {
+    std::vector<int> order(document_terms.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    GraphBisection bisection(document_terms, term_count);
+    bisection.Bisect(order.begin(), order.end(), 0);
+
+    return order;
+}
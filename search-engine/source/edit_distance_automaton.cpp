@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <climits>
+
+#include "edit_distance_automaton.h"
+
+EditDistanceAutomaton::EditDistanceAutomaton(std::string_view word, int max_distance)
+    : word_(word), max_distance_(max_distance), word_characters_(word.begin(), word.end()),
+      rows_(word.size() + 1), row_minimums_(1, 0), candidate_row_(word.size() + 1) {
+    std::sort(word_characters_.begin(), word_characters_.end());
+    word_characters_.erase(std::unique(word_characters_.begin(), word_characters_.end()), word_characters_.end());
+
+    for (size_t index = 0; index <= word_.size(); ++index) {
+        rows_[index] = static_cast<int>(index);
+    }
+}
+
+size_t EditDistanceAutomaton::Feed(std::string_view term) {
+    const size_t max_shared_size = std::min(prefix_.size(), term.size());
+    size_t shared_size = 0;
+    while (shared_size < max_shared_size && prefix_[shared_size] == term[shared_size]) {
+        ++shared_size;
+    }
+    prefix_.resize(shared_size);
+
+    for (size_t size = 1; size <= shared_size; ++size) {
+        if (row_minimums_[size] > max_distance_) {
+            return size - 1;
+        }
+    }
+
+    for (size_t size = shared_size; size < term.size(); ++size) {
+        rows_.resize((size + 2) * (word_.size() + 1));
+        row_minimums_.resize(size + 2);
+
+        const int minimum = ComputeRow(size, static_cast<unsigned char>(term[size]), GetRow(size + 1));
+        prefix_.push_back(term[size]);
+        row_minimums_[size + 1] = minimum;
+
+        if (minimum > max_distance_) {
+            return size;
+        }
+    }
+
+    return term.size();
+}
+
+bool EditDistanceAutomaton::FindNextTerm(std::string_view term, size_t viable_size, std::string& next_term) {
+    for (size_t size = viable_size + 1; size-- > 0;) {
+        const unsigned first_character = static_cast<unsigned char>(term[size]) + 1u;
+        if (first_character > UCHAR_MAX) {
+            continue;
+        }
+
+        std::optional<unsigned char> character;
+        if (row_minimums_[size] < max_distance_) {
+            // Any character costs at most one more edit.
+            character = static_cast<unsigned char>(first_character);
+        } else {
+            for (auto word_character = std::lower_bound(word_characters_.begin(), word_characters_.end(), first_character);
+                 word_character != word_characters_.end(); ++word_character) {
+                if (ComputeRow(size, *word_character, candidate_row_.data()) <= max_distance_) {
+                    character = *word_character;
+                    break;
+                }
+            }
+        }
+
+        if (character) {
+            next_term.assign(term.substr(0, size));
+            next_term.push_back(static_cast<char>(*character));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int* EditDistanceAutomaton::GetRow(size_t prefix_size) {
+    return rows_.data() + prefix_size * (word_.size() + 1);
+}
+
+int EditDistanceAutomaton::ComputeRow(size_t prefix_size, unsigned char character, int* row) {
+    const int* previous_row = GetRow(prefix_size);
+    const int* before_previous_row = prefix_size > 0 ? GetRow(prefix_size - 1) : nullptr;
+    const unsigned char previous_character = prefix_size > 0 ? static_cast<unsigned char>(prefix_[prefix_size - 1]) : 0;
+
+    row[0] = static_cast<int>(prefix_size) + 1;
+    int minimum = row[0];
+
+    for (size_t index = 1; index <= word_.size(); ++index) {
+        const unsigned char word_character = static_cast<unsigned char>(word_[index - 1]);
+
+        int distance = std::min({
+            previous_row[index - 1] + (word_character != character ? 1 : 0),
+            previous_row[index] + 1,
+            row[index - 1] + 1
+        });
+
+        if (before_previous_row != nullptr && index > 1 && character == static_cast<unsigned char>(word_[index - 2])
+            && previous_character == word_character) {
+            distance = std::min(distance, before_previous_row[index - 2] + 1);
+        }
+
+        row[index] = distance;
+        minimum = std::min(minimum, distance);
+    }
+
+    return minimum;
+}
@@ -28,5 +28,47 @@ int main() {
     LOG_DURATION("duplicates");
     RunRemoveDuplicates();
     }
+
+    std::cout << std::endl << "SAMPLE BOUNDED QUERY WITH REQUIRED WORDS" << std::endl << std::endl;
+
+    {
+    LOG_DURATION("bounded");
+    RunBoundedRequiredWords();
+    }
+
+    std::cout << std::endl << "SAMPLE RESUMED AND ASYNC QUERIES" << std::endl << std::endl;
+
+    {
+    LOG_DURATION("resumed");
+    RunResumedQueries();
+    }
+
+    std::cout << std::endl << "SAMPLE UPDATE DOCUMENTS" << std::endl << std::endl;
+
+    {
+    LOG_DURATION("update");
+    RunUpdateDocuments();
+    }
+
+    std::cout << std::endl << "SAMPLE REORDER DOCUMENTS" << std::endl << std::endl;
+
+    {
+    LOG_DURATION("reorder");
+    RunReorderDocuments();
+    }
+
+    std::cout << std::endl << "SAMPLE TYPO EXPANSION" << std::endl << std::endl;
+
+    {
+    LOG_DURATION("typos");
+    RunTypoExpansion();
+    }
+
+    std::cout << std::endl << "SAMPLE QUERY PROTOCOL OVER LOOPBACK" << std::endl << std::endl;
+
+    {
+    LOG_DURATION("protocol");
+    RunQueryProtocol();
+    }
     return 0;
 }
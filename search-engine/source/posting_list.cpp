@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cassert>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SEARCH_ENGINE_HAS_AVX2_DISPATCH 1
+#endif
+
+#include "posting_list.h"
+
+namespace {
+
+// Galloping stops once the target is known to be within this many IDs, they are compared at once.
+const size_t kScanBlockSize = 16;
+
+size_t CountLessScalar(const int* ids, size_t count, int document_id) {
+    size_t less_count = 0;
+    for (size_t index = 0; index < count; ++index) {
+        less_count += ids[index] < document_id;
+    }
+
+    return less_count;
+}
+
+#ifdef SEARCH_ENGINE_HAS_AVX2_DISPATCH
+__attribute__((target("avx2")))
+size_t CountLessAvx2(const int* ids, size_t count, int document_id) {
+    const __m256i target = _mm256_set1_epi32(document_id);
+    size_t less_count = 0;
+    size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + index));
+        const __m256i is_less = _mm256_cmpgt_epi32(target, block);
+        less_count += static_cast<size_t>(__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(is_less))));
+    }
+
+    return less_count + CountLessScalar(ids + index, count - index, document_id);
+}
+
+const bool kHasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+// ids is sorted, so the number of IDs less than document_id is the position of the first one that is not.
+size_t CountLess(const int* ids, size_t count, int document_id) {
+#ifdef SEARCH_ENGINE_HAS_AVX2_DISPATCH
+    if (kHasAvx2) {
+        return CountLessAvx2(ids, count, document_id);
+    }
+#endif
+
+    return CountLessScalar(ids, count, document_id);
+}
+
+} //namespace
+
+void PostingList::Append(int document_id, double term_freq) {
+    assert(document_ids_.empty() || document_ids_.back() < document_id);
+
+    document_ids_.push_back(document_id);
+    term_freqs_.push_back(term_freq);
+}
+
+void PostingList::Set(int document_id, double term_freq) {
+    const size_t position = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id)
+        - document_ids_.begin();
+
+    if (position < document_ids_.size() && document_ids_[position] == document_id) {
+        if (IsErased(term_freqs_[position])) {
+            --erased_count_;
+        }
+        term_freqs_[position] = term_freq;
+        return;
+    }
+
+    // The next tombstone takes the place of the last shifted posting.
+    if (erased_count_ > 0) {
+        const size_t erased = std::find_if(term_freqs_.begin() + position, term_freqs_.end(), IsErased)
+            - term_freqs_.begin();
+        if (erased < term_freqs_.size()) {
+            std::copy_backward(document_ids_.begin() + position, document_ids_.begin() + erased,
+                               document_ids_.begin() + erased + 1);
+            std::copy_backward(term_freqs_.begin() + position, term_freqs_.begin() + erased,
+                               term_freqs_.begin() + erased + 1);
+            document_ids_[position] = document_id;
+            term_freqs_[position] = term_freq;
+            --erased_count_;
+            return;
+        }
+    }
+
+    document_ids_.insert(document_ids_.begin() + position, document_id);
+    term_freqs_.insert(term_freqs_.begin() + position, term_freq);
+}
+
+bool PostingList::Erase(int document_id) {
+    const auto document = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (document == document_ids_.end() || *document != document_id) {
+        return false;
+    }
+
+    double& term_freq = term_freqs_[document - document_ids_.begin()];
+    if (IsErased(term_freq)) {
+        return false;
+    }
+
+    term_freq = kErasedTermFreq;
+    ++erased_count_;
+    if (erased_count_ * 4 > document_ids_.size()) {
+        Compact();
+    }
+
+    return true;
+}
+
+bool PostingList::Contains(int document_id) const {
+    return FindTermFreq(document_id).has_value();
+}
+
+std::optional<double> PostingList::FindTermFreq(int document_id) const {
+    const auto document = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (document == document_ids_.end() || *document != document_id) {
+        return std::nullopt;
+    }
+
+    const double term_freq = term_freqs_[document - document_ids_.begin()];
+    if (IsErased(term_freq)) {
+        return std::nullopt;
+    }
+
+    return term_freq;
+}
+
+const std::vector<int>& PostingList::GetDocumentIds() const {
+    return document_ids_;
+}
+
+const std::vector<double>& PostingList::GetTermFreqs() const {
+    return term_freqs_;
+}
+
+size_t PostingList::GetSize() const {
+    return document_ids_.size() - erased_count_;
+}
+
+bool PostingList::IsEmpty() const {
+    return GetSize() == 0;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return document_ids_.capacity() * sizeof(int) + term_freqs_.capacity() * sizeof(double);
+}
+
+void PostingList::Compact() {
+    size_t kept_count = 0;
+    for (size_t posting = 0; posting < document_ids_.size(); ++posting) {
+        if (!IsErased(term_freqs_[posting])) {
+            document_ids_[kept_count] = document_ids_[posting];
+            term_freqs_[kept_count] = term_freqs_[posting];
+            ++kept_count;
+        }
+    }
+
+    document_ids_.resize(kept_count);
+    term_freqs_.resize(kept_count);
+    erased_count_ = 0;
+}
+
+size_t posting_search::GallopTo(const std::vector<int>& sorted_ids, size_t from, int document_id) {
+    const size_t size = sorted_ids.size();
+    if (from >= size || sorted_ids[from] >= document_id) {
+        return from;
+    }
+
+    // Invariant: sorted_ids[low] < document_id and sorted_ids[high] >= document_id (or high == size).
+    size_t low = from;
+    size_t step = 1;
+    while (from + step < size && sorted_ids[from + step] < document_id) {
+        low = from + step;
+        step *= 2;
+    }
+    size_t high = std::min(from + step, size);
+
+    while (high - low > kScanBlockSize) {
+        const size_t middle = low + (high - low) / 2;
+        if (sorted_ids[middle] < document_id) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low + 1 + CountLess(sorted_ids.data() + low + 1, high - low - 1, document_id);
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+
+#include "query_executor.h"
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    threads_.reserve(thread_count);
+
+    for (size_t index = 0; index < thread_count; ++index) {
+        threads_.emplace_back([this] {
+            WorkerLoop();
+        });
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        std::lock_guard lock(mutex_);
+        is_stopping_ = true;
+    }
+    has_tasks_.notify_all();
+
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void QueryExecutor::Submit(QueryPriority priority, std::function<bool()> step) {
+    {
+        std::lock_guard lock(mutex_);
+        tasks_[static_cast<size_t>(priority)].push_back(std::move(step));
+    }
+    has_tasks_.notify_one();
+}
+
+size_t QueryExecutor::GetThreadCount() const {
+    return threads_.size();
+}
+
+QueryExecutor& QueryExecutor::GetDefault() {
+    static QueryExecutor executor(std::thread::hardware_concurrency());
+    return executor;
+}
+
+void QueryExecutor::WorkerLoop() {
+    std::deque<std::function<bool()>>& interactive_tasks = tasks_[static_cast<size_t>(QueryPriority::kInteractive)];
+    std::deque<std::function<bool()>>& batch_tasks = tasks_[static_cast<size_t>(QueryPriority::kBatch)];
+
+    while (true) {
+        std::function<bool()> step;
+        std::deque<std::function<bool()>>* queue = nullptr;
+        {
+            std::unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [&] {
+                return is_stopping_ || !interactive_tasks.empty() || !batch_tasks.empty();
+            });
+
+            if (interactive_tasks.empty() && batch_tasks.empty()) {
+                return;
+            }
+
+            if (!interactive_tasks.empty()
+                && (batch_tasks.empty() || interactive_steps_in_row_ < kInteractiveStepsPerBatchStep)) {
+                queue = &interactive_tasks;
+                ++interactive_steps_in_row_;
+            } else {
+                queue = &batch_tasks;
+                interactive_steps_in_row_ = 0;
+            }
+
+            step = std::move(queue->front());
+            queue->pop_front();
+        }
+
+        bool is_done = true;
+        try {
+            is_done = step();
+        } catch (...) {
+        }
+
+        if (!is_done) {
+            // Back to the end of its queue: queries of the same priority take turns.
+            {
+                std::lock_guard lock(mutex_);
+                queue->push_back(std::move(step));
+            }
+            has_tasks_.notify_one();
+        }
+    }
+}
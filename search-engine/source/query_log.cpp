@@ -0,0 +1,115 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "query_log.h"
+
+using namespace std::literals::string_literals;
+
+namespace {
+
+const size_t kMagicSize = sizeof(query_log::kMagic) - 1;
+// Guards against allocating for a corrupted size.
+const uint32_t kMaxQuerySize = 1024 * 1024;
+
+void WriteVarint(std::string& output, uint64_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+uint64_t EncodeZigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t DecodeZigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Returns std::nullopt if the stream ends before the first byte.
+std::optional<uint64_t> ReadVarint(std::istream& input) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const int byte = input.get();
+        if (byte == std::char_traits<char>::eof()) {
+            if (shift == 0) {
+                return std::nullopt;
+            }
+            throw std::invalid_argument("Truncated query log record."s);
+        }
+
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+
+    throw std::invalid_argument("Malformed varint in query log."s);
+}
+
+uint32_t ReadUint32(std::istream& input) {
+    const std::optional<uint64_t> value = ReadVarint(input);
+    if (!value || *value > UINT32_MAX) {
+        throw std::invalid_argument("Truncated query log record."s);
+    }
+
+    return static_cast<uint32_t>(*value);
+}
+
+} //namespace
+
+query_log::Writer::Writer(std::ostream& output) : output_(output) {
+    output_.write(kMagic, kMagicSize);
+    output_.put(static_cast<char>(kVersion));
+}
+
+void query_log::Writer::Write(const Record& record) {
+    buffer_.clear();
+    WriteVarint(buffer_, EncodeZigzag(record.timestamp_us - previous_timestamp_us_));
+    WriteVarint(buffer_, record.filter_key);
+    WriteVarint(buffer_, record.result_count);
+    WriteVarint(buffer_, record.latency_us);
+    WriteVarint(buffer_, record.raw_query.size());
+    buffer_.append(record.raw_query);
+
+    output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    previous_timestamp_us_ = record.timestamp_us;
+}
+
+query_log::Reader::Reader(std::istream& input) : input_(input) {
+    char header[kMagicSize + 1] = {};
+    input_.read(header, sizeof(header));
+    if (input_.gcount() != sizeof(header) || std::memcmp(header, kMagic, kMagicSize) != 0) {
+        throw std::invalid_argument("Not a query log."s);
+    }
+    if (static_cast<uint8_t>(header[kMagicSize]) != kVersion) {
+        throw std::invalid_argument("Unsupported query log version."s);
+    }
+}
+
+std::optional<query_log::Record> query_log::Reader::Read() {
+    const std::optional<uint64_t> timestamp_delta = ReadVarint(input_);
+    if (!timestamp_delta) {
+        return std::nullopt;
+    }
+
+    Record record;
+    record.timestamp_us = previous_timestamp_us_ + DecodeZigzag(*timestamp_delta);
+    record.filter_key = ReadUint32(input_);
+    record.result_count = ReadUint32(input_);
+    record.latency_us = ReadUint32(input_);
+
+    const uint32_t query_size = ReadUint32(input_);
+    if (query_size > kMaxQuerySize) {
+        throw std::invalid_argument("Malformed query size in query log."s);
+    }
+    record.raw_query.resize(query_size);
+    input_.read(record.raw_query.data(), static_cast<std::streamsize>(record.raw_query.size()));
+    if (input_.gcount() != static_cast<std::streamsize>(record.raw_query.size())) {
+        throw std::invalid_argument("Truncated query log record."s);
+    }
+
+    previous_timestamp_us_ = record.timestamp_us;
+    return record;
+}
@@ -0,0 +1,294 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "query_protocol.h"
+
+using namespace std::literals::string_literals;
+
+namespace {
+
+void WriteUint32(std::string& output, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        output.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void WriteUint64(std::string& output, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        output.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void WriteInt32(std::string& output, int value) {
+    WriteUint32(output, static_cast<uint32_t>(value));
+}
+
+void WriteDouble(std::string& output, double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteUint64(output, bits);
+}
+
+void WriteString(std::string& output, std::string_view value) {
+    WriteUint32(output, static_cast<uint32_t>(value.size()));
+    output.append(value);
+}
+
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view data) : data_(data) {
+    }
+
+    uint8_t ReadUint8() {
+        Require(1);
+        return static_cast<uint8_t>(data_[position_++]);
+    }
+
+    uint32_t ReadUint32() {
+        Require(4);
+        uint32_t value = 0;
+        for (int index = 0; index < 4; ++index) {
+            value = (value << 8) | static_cast<uint8_t>(data_[position_++]);
+        }
+        return value;
+    }
+
+    uint64_t ReadUint64() {
+        Require(8);
+        uint64_t value = 0;
+        for (int index = 0; index < 8; ++index) {
+            value = (value << 8) | static_cast<uint8_t>(data_[position_++]);
+        }
+        return value;
+    }
+
+    int ReadInt32() {
+        return static_cast<int>(ReadUint32());
+    }
+
+    double ReadDouble() {
+        const uint64_t bits = ReadUint64();
+        double value = 0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::string ReadString() {
+        const uint32_t size = ReadUint32();
+        Require(size);
+        std::string value(data_.substr(position_, size));
+        position_ += size;
+        return value;
+    }
+
+    DocumentStatus ReadStatus() {
+        const uint8_t status = ReadUint8();
+        if (status > static_cast<uint8_t>(DocumentStatus::kRemoved)) {
+            throw std::invalid_argument("Unknown document status in message."s);
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+    void ExpectEnd() const {
+        if (position_ != data_.size()) {
+            throw std::invalid_argument("Unexpected trailing bytes in message."s);
+        }
+    }
+
+private:
+    void Require(size_t size) const {
+        if (data_.size() - position_ < size) {
+            throw std::invalid_argument("Message is truncated."s);
+        }
+    }
+
+private:
+    std::string_view data_;
+    size_t position_ = 0;
+};
+
+ByteReader ReadOkResponse(std::string_view payload) {
+    query_protocol::CheckResponse(payload);
+    ByteReader reader(payload);
+    reader.ReadUint8();
+
+    return reader;
+}
+
+} //namespace
+
+void query_protocol::AppendFrame(std::string& output, std::string_view payload) {
+    WriteUint32(output, static_cast<uint32_t>(payload.size()));
+    output.append(payload);
+}
+
+std::optional<size_t> query_protocol::PeekFrame(std::string_view buffer) {
+    if (buffer.size() < kFrameHeaderSize) {
+        return std::nullopt;
+    }
+
+    const uint32_t payload_size = ByteReader(buffer).ReadUint32();
+    if (payload_size > kMaxFrameSize) {
+        throw std::invalid_argument("Frame exceeds maximum size."s);
+    }
+
+    if (buffer.size() - kFrameHeaderSize < payload_size) {
+        return std::nullopt;
+    }
+
+    return payload_size;
+}
+
+std::string query_protocol::EncodeRequest(const Request& request) {
+    std::string payload;
+    payload.push_back(static_cast<char>(request.operation));
+
+    switch (request.operation) {
+    case Operation::kFindTopDocuments:
+        payload.push_back(static_cast<char>(request.status));
+        WriteString(payload, request.text);
+        break;
+    case Operation::kMatchDocument:
+        WriteInt32(payload, request.document_id);
+        WriteString(payload, request.text);
+        break;
+    case Operation::kAddDocument:
+        WriteInt32(payload, request.document_id);
+        payload.push_back(static_cast<char>(request.status));
+        WriteUint32(payload, static_cast<uint32_t>(request.ratings.size()));
+        for (const int rating : request.ratings) {
+            WriteInt32(payload, rating);
+        }
+        WriteString(payload, request.text);
+        break;
+    case Operation::kRemoveDocument:
+        WriteInt32(payload, request.document_id);
+        break;
+    }
+
+    return payload;
+}
+
+query_protocol::Request query_protocol::DecodeRequest(std::string_view payload) {
+    ByteReader reader(payload);
+    Request request;
+
+    const uint8_t operation = reader.ReadUint8();
+    if (operation < static_cast<uint8_t>(Operation::kFindTopDocuments)
+        || operation > static_cast<uint8_t>(Operation::kRemoveDocument)) {
+        throw std::invalid_argument("Unknown operation."s);
+    }
+    request.operation = static_cast<Operation>(operation);
+
+    switch (request.operation) {
+    case Operation::kFindTopDocuments:
+        request.status = reader.ReadStatus();
+        request.text = reader.ReadString();
+        break;
+    case Operation::kMatchDocument:
+        request.document_id = reader.ReadInt32();
+        request.text = reader.ReadString();
+        break;
+    case Operation::kAddDocument: {
+        request.document_id = reader.ReadInt32();
+        request.status = reader.ReadStatus();
+        const uint32_t rating_count = reader.ReadUint32();
+        if (rating_count > payload.size() / 4) {
+            throw std::invalid_argument("Message is truncated."s);
+        }
+        request.ratings.reserve(rating_count);
+        for (uint32_t index = 0; index < rating_count; ++index) {
+            request.ratings.push_back(reader.ReadInt32());
+        }
+        request.text = reader.ReadString();
+        break;
+    }
+    case Operation::kRemoveDocument:
+        request.document_id = reader.ReadInt32();
+        break;
+    }
+
+    reader.ExpectEnd();
+
+    return request;
+}
+
+std::string query_protocol::EncodeDocuments(const std::vector<Document>& documents) {
+    std::string payload;
+    payload.push_back(static_cast<char>(ResponseStatus::kOk));
+    WriteUint32(payload, static_cast<uint32_t>(documents.size()));
+
+    for (const Document& document : documents) {
+        WriteInt32(payload, document.id);
+        WriteDouble(payload, document.relevance);
+        WriteInt32(payload, document.rating);
+    }
+
+    return payload;
+}
+
+std::vector<Document> query_protocol::DecodeDocuments(std::string_view payload) {
+    ByteReader reader = ReadOkResponse(payload);
+
+    const uint32_t document_count = reader.ReadUint32();
+    std::vector<Document> documents;
+
+    for (uint32_t index = 0; index < document_count; ++index) {
+        Document document;
+        document.id = reader.ReadInt32();
+        document.relevance = reader.ReadDouble();
+        document.rating = reader.ReadInt32();
+        documents.push_back(document);
+    }
+    reader.ExpectEnd();
+
+    return documents;
+}
+
+std::string query_protocol::EncodeMatchResult(const std::vector<std::string>& words, DocumentStatus status) {
+    std::string payload;
+    payload.push_back(static_cast<char>(ResponseStatus::kOk));
+    payload.push_back(static_cast<char>(status));
+    WriteUint32(payload, static_cast<uint32_t>(words.size()));
+
+    for (const std::string& word : words) {
+        WriteString(payload, word);
+    }
+
+    return payload;
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> query_protocol::DecodeMatchResult(std::string_view payload) {
+    ByteReader reader = ReadOkResponse(payload);
+
+    const DocumentStatus status = reader.ReadStatus();
+    const uint32_t word_count = reader.ReadUint32();
+    std::vector<std::string> words;
+
+    for (uint32_t index = 0; index < word_count; ++index) {
+        words.push_back(reader.ReadString());
+    }
+    reader.ExpectEnd();
+
+    return {words, status};
+}
+
+std::string query_protocol::EncodeOk() {
+    return std::string(1, static_cast<char>(ResponseStatus::kOk));
+}
+
+std::string query_protocol::EncodeError(std::string_view message) {
+    std::string payload;
+    payload.push_back(static_cast<char>(ResponseStatus::kError));
+    WriteString(payload, message);
+
+    return payload;
+}
+
+void query_protocol::CheckResponse(std::string_view payload) {
+    ByteReader reader(payload);
+
+    if (static_cast<ResponseStatus>(reader.ReadUint8()) == ResponseStatus::kError) {
+        throw std::runtime_error(reader.ReadString());
+    }
+}
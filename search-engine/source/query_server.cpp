@@ -0,0 +1,428 @@
+#if defined(__linux__)
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "query_server.h"
+
+using namespace std::literals::string_literals;
+
+namespace {
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::runtime_error(what + ": "s + std::strerror(errno));
+}
+
+bool IsMutation(query_protocol::Operation operation) {
+    return operation == query_protocol::Operation::kAddDocument
+        || operation == query_protocol::Operation::kRemoveDocument;
+}
+
+} //namespace
+
+QueryServer::QueryServer(SearchServer& search_server, const QueryServerOptions& options)
+    : search_server_(search_server)
+    , options_(options) {
+    listener_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener_socket_ < 0) {
+        ThrowSystemError("socket"s);
+    }
+
+    const int enable = 1;
+    setsockopt(listener_socket_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options_.port);
+    if (inet_pton(AF_INET, options_.address.c_str(), &address.sin_addr) != 1) {
+        close(listener_socket_);
+        throw std::invalid_argument("Invalid listen address: "s + options_.address);
+    }
+
+    if (bind(listener_socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listener_socket_, options_.listen_backlog) < 0) {
+        const int bind_error = errno;
+        close(listener_socket_);
+        errno = bind_error;
+        ThrowSystemError("bind/listen"s);
+    }
+
+    epoll_descriptor_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_descriptor_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_descriptor_ < 0 || wakeup_descriptor_ < 0) {
+        ThrowSystemError("epoll/eventfd"s);
+    }
+
+    epoll_event listener_event{};
+    listener_event.events = EPOLLIN;
+    listener_event.data.u64 = kListenerId;
+    epoll_ctl(epoll_descriptor_, EPOLL_CTL_ADD, listener_socket_, &listener_event);
+
+    epoll_event wakeup_event{};
+    wakeup_event.events = EPOLLIN;
+    wakeup_event.data.u64 = kWakeupId;
+    epoll_ctl(epoll_descriptor_, EPOLL_CTL_ADD, wakeup_descriptor_, &wakeup_event);
+
+    spare_descriptor_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    workers_ = std::make_unique<ThreadPool>(options_.worker_count);
+}
+
+QueryServer::~QueryServer() {
+    workers_.reset();
+
+    for (const auto& [_, connection] : connections_) {
+        close(connection.socket);
+    }
+
+    close(spare_descriptor_);
+    close(wakeup_descriptor_);
+    close(epoll_descriptor_);
+    close(listener_socket_);
+}
+
+uint16_t QueryServer::GetPort() const {
+    sockaddr_in address{};
+    socklen_t address_size = sizeof(address);
+    getsockname(listener_socket_, reinterpret_cast<sockaddr*>(&address), &address_size);
+
+    return ntohs(address.sin_port);
+}
+
+void QueryServer::Run() {
+    epoll_event events[kMaxEventsPerWait];
+
+    while (!is_stop_requested_) {
+        const int event_count = epoll_wait(epoll_descriptor_, events, kMaxEventsPerWait, -1);
+        if (event_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+
+        for (int index = 0; index < event_count; ++index) {
+            const uint64_t id = events[index].data.u64;
+
+            if (id == kListenerId) {
+                AcceptConnections();
+            } else if (id == kWakeupId) {
+                uint64_t counter = 0;
+                [[maybe_unused]] const ssize_t _ = read(wakeup_descriptor_, &counter, sizeof(counter));
+                DrainCompletions();
+            } else {
+                HandleConnectionEvent(id, events[index].events);
+            }
+        }
+    }
+}
+
+void QueryServer::Stop() {
+    is_stop_requested_ = true;
+
+    const uint64_t counter = 1;
+    [[maybe_unused]] const ssize_t _ = write(wakeup_descriptor_, &counter, sizeof(counter));
+}
+
+void QueryServer::AcceptConnections() {
+    while (true) {
+        const int client_socket = accept4(listener_socket_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Out of descriptors the listener stays readable and the loop would spin, so the spare
+            // descriptor is given up to accept the connection and close it right away.
+            if ((errno == EMFILE || errno == ENFILE) && spare_descriptor_ >= 0) {
+                close(spare_descriptor_);
+                const int rejected_socket = accept4(listener_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (rejected_socket >= 0) {
+                    close(rejected_socket);
+                }
+                spare_descriptor_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                if (rejected_socket >= 0) {
+                    continue;
+                }
+            }
+            return;
+        }
+
+        const int enable = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        const uint64_t connection_id = next_connection_id_++;
+        Connection& connection = connections_[connection_id];
+        connection.socket = client_socket;
+        connection.registered_events = EPOLLIN | EPOLLRDHUP;
+
+        epoll_event event{};
+        event.events = connection.registered_events;
+        event.data.u64 = connection_id;
+        if (epoll_ctl(epoll_descriptor_, EPOLL_CTL_ADD, client_socket, &event) < 0) {
+            close(client_socket);
+            connections_.erase(connection_id);
+        }
+    }
+}
+
+void QueryServer::DrainCompletions() {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard lock(completions_mutex_);
+        completions.swap(completions_);
+    }
+
+    std::vector<uint64_t> touched_connections;
+
+    for (Completion& completion : completions) {
+        const auto connection_iterator = connections_.find(completion.connection_id);
+        if (connection_iterator == connections_.end()) {
+            continue;
+        }
+
+        Connection& connection = connection_iterator->second;
+        // A mutation runs alone, so it is over once nothing is in flight.
+        if (--connection.requests_in_flight == 0) {
+            connection.is_mutation_in_flight = false;
+        }
+        connection.ready_responses.emplace(completion.sequence, std::move(completion.response));
+        touched_connections.push_back(completion.connection_id);
+    }
+
+    std::sort(touched_connections.begin(), touched_connections.end());
+    touched_connections.erase(std::unique(touched_connections.begin(), touched_connections.end()),
+        touched_connections.end());
+
+    for (const uint64_t connection_id : touched_connections) {
+        if (connections_.count(connection_id)) {
+            HandleConnectionEvent(connection_id, 0);
+        }
+    }
+}
+
+void QueryServer::HandleConnectionEvent(uint64_t connection_id, uint32_t events) {
+    Connection& connection = connections_.at(connection_id);
+
+    if (events & EPOLLERR) {
+        CloseConnection(connection_id);
+        return;
+    }
+
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) && !ReadInput(connection)) {
+        CloseConnection(connection_id);
+        return;
+    }
+
+    if (!ParseRequests(connection)) {
+        CloseConnection(connection_id);
+        return;
+    }
+    SubmitRequests(connection_id, connection);
+
+    CollectReadyResponses(connection);
+
+    if (!WriteOutput(connection)) {
+        CloseConnection(connection_id);
+        return;
+    }
+
+    const bool is_drained = connection.requests_in_flight == 0 && connection.pending_requests.empty()
+        && connection.output.empty();
+    if (connection.is_peer_closed && is_drained) {
+        CloseConnection(connection_id);
+        return;
+    }
+
+    UpdateInterest(connection_id, connection);
+}
+
+bool QueryServer::ReadInput(Connection& connection) {
+    if (connection.is_peer_closed) {
+        return true;
+    }
+
+    char buffer[kReadChunkSize];
+
+    while (true) {
+        const ssize_t received = recv(connection.socket, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<size_t>(received));
+            if (static_cast<size_t>(received) < sizeof(buffer)) {
+                return true;
+            }
+        } else if (received == 0) {
+            connection.is_peer_closed = true;
+            return true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+}
+
+bool QueryServer::ParseRequests(Connection& connection) {
+    size_t offset = 0;
+
+    while (connection.requests_in_flight + connection.pending_requests.size() < options_.max_pipelined_requests) {
+        std::optional<size_t> payload_size;
+        try {
+            payload_size = query_protocol::PeekFrame(std::string_view(connection.input).substr(offset));
+        } catch (const std::invalid_argument&) {
+            return false;
+        }
+
+        if (!payload_size) {
+            break;
+        }
+
+        const std::string_view payload = std::string_view(connection.input)
+            .substr(offset + query_protocol::kFrameHeaderSize, *payload_size);
+        offset += query_protocol::kFrameHeaderSize + *payload_size;
+
+        const uint64_t sequence = connection.next_sequence++;
+
+        query_protocol::Request request;
+        try {
+            request = query_protocol::DecodeRequest(payload);
+        } catch (const std::exception& e) {
+            connection.ready_responses.emplace(sequence, query_protocol::EncodeError(e.what()));
+            continue;
+        }
+
+        connection.pending_requests.push_back({sequence, std::move(request)});
+    }
+
+    connection.input.erase(0, offset);
+
+    return true;
+}
+
+void QueryServer::SubmitRequests(uint64_t connection_id, Connection& connection) {
+    while (!connection.pending_requests.empty() && !connection.is_mutation_in_flight) {
+        const bool is_mutation = IsMutation(connection.pending_requests.front().request.operation);
+        if (is_mutation && connection.requests_in_flight > 0) {
+            return;
+        }
+
+        PendingRequest pending_request = std::move(connection.pending_requests.front());
+        connection.pending_requests.pop_front();
+
+        ++connection.requests_in_flight;
+        connection.is_mutation_in_flight = is_mutation;
+        workers_->Submit([this, connection_id, sequence = pending_request.sequence,
+                          request = std::move(pending_request.request)] {
+            std::string response = Execute(request);
+            {
+                std::lock_guard lock(completions_mutex_);
+                completions_.push_back({connection_id, sequence, std::move(response)});
+            }
+
+            const uint64_t counter = 1;
+            [[maybe_unused]] const ssize_t _ = write(wakeup_descriptor_, &counter, sizeof(counter));
+        });
+    }
+}
+
+void QueryServer::CollectReadyResponses(Connection& connection) {
+    auto response = connection.ready_responses.begin();
+
+    while (response != connection.ready_responses.end() && response->first == connection.next_sequence_to_send) {
+        query_protocol::AppendFrame(connection.output, response->second);
+        ++connection.next_sequence_to_send;
+        response = connection.ready_responses.erase(response);
+    }
+}
+
+bool QueryServer::WriteOutput(Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t sent = send(connection.socket, connection.output.data() + connection.output_offset,
+            connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (sent >= 0) {
+            connection.output_offset += static_cast<size_t>(sent);
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+
+    connection.output.clear();
+    connection.output_offset = 0;
+
+    return true;
+}
+
+void QueryServer::UpdateInterest(uint64_t connection_id, Connection& connection) {
+    uint32_t events = 0;
+
+    if (!connection.is_peer_closed
+        && connection.requests_in_flight + connection.pending_requests.size() < options_.max_pipelined_requests) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+
+    if (events == connection.registered_events) {
+        return;
+    }
+
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = connection_id;
+    epoll_ctl(epoll_descriptor_, EPOLL_CTL_MOD, connection.socket, &event);
+    connection.registered_events = events;
+}
+
+void QueryServer::CloseConnection(uint64_t connection_id) {
+    const auto connection_iterator = connections_.find(connection_id);
+
+    epoll_ctl(epoll_descriptor_, EPOLL_CTL_DEL, connection_iterator->second.socket, nullptr);
+    close(connection_iterator->second.socket);
+    connections_.erase(connection_iterator);
+}
+
+std::string QueryServer::Execute(const query_protocol::Request& request) {
+    using query_protocol::Operation;
+
+    try {
+        switch (request.operation) {
+        case Operation::kFindTopDocuments: {
+            std::shared_lock lock(search_server_mutex_);
+            return query_protocol::EncodeDocuments(search_server_.FindTopDocuments(request.text, request.status));
+        }
+        case Operation::kMatchDocument: {
+            std::shared_lock lock(search_server_mutex_);
+            const auto [words, status] = search_server_.MatchDocument(request.text, request.document_id);
+            return query_protocol::EncodeMatchResult(words, status);
+        }
+        case Operation::kAddDocument: {
+            std::unique_lock lock(search_server_mutex_);
+            search_server_.AddDocument(request.document_id, request.text, request.status, request.ratings);
+            return query_protocol::EncodeOk();
+        }
+        case Operation::kRemoveDocument: {
+            std::unique_lock lock(search_server_mutex_);
+            search_server_.RemoveDocument(request.document_id);
+            return query_protocol::EncodeOk();
+        }
+        }
+    } catch (const std::exception& e) {
+        return query_protocol::EncodeError(e.what());
+    }
+
+    return query_protocol::EncodeError("Unknown operation."s);
+}
+
+#endif
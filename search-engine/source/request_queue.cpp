@@ -1,3 +1,5 @@
+#include <chrono>
+
 #include "request_queue.h"
 #include "search_server.h"
 
@@ -8,9 +10,27 @@ RequestQueue::RequestQueue(const SearchServer& search_server)
 
 template <typename DocumentPredicate>
 void RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    FindAndRecord(raw_query, document_predicate, query_log::kPredicateFilterKey);
+}
+
+template <typename Filter>
+void RequestQueue::FindAndRecord(const std::string& raw_query, Filter filter, uint32_t filter_key) {
+    using namespace std::chrono;
+
     ++timestamp_;
 
-    std::vector<Document> result = server_.FindTopDocuments(raw_query, document_predicate);
+    const auto start_time = steady_clock::now();
+    std::vector<Document> result = server_.FindTopDocuments(raw_query, filter);
+
+    if (query_log_ != nullptr) {
+        query_log_->Write({
+            .timestamp_us = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count(),
+            .raw_query = raw_query,
+            .filter_key = filter_key,
+            .result_count = static_cast<uint32_t>(result.size()),
+            .latency_us = static_cast<uint32_t>(duration_cast<microseconds>(steady_clock::now() - start_time).count()),
+        });
+    }
 
     UpdateQueue(raw_query, result);
 }
@@ -37,9 +57,8 @@ void RequestQueue::RemoveFromQueue() {
 }
 
 void RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return AddFindRequest(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    // The status overload, not a predicate, so that the logged latency is that of the path the replay runs.
+    return FindAndRecord(raw_query, status, static_cast<uint32_t>(status));
 }
 
 void RequestQueue::AddFindRequest(const std::string& raw_query) {
@@ -57,3 +76,7 @@ int RequestQueue::GetNoResultRequests() const {
 
     return no_result_requests;
 }
+
+void RequestQueue::SetQueryLog(query_log::Writer* query_log) {
+    query_log_ = query_log;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SEARCH_ENGINE_HAS_AVX_DISPATCH 1
+#endif
+
+#include "scoring_kernels.h"
+
+namespace {
+
+template <typename Score>
+void AddScoresScalar(const int* document_ids, const double* term_freqs, size_t count, double weight, Score* scores) {
+    for (size_t index = 0; index < count; ++index) {
+        if (term_freqs[index] >= 0) {
+            Score& score = scores[document_ids[index]];
+            score = std::max(score, Score{0}) + static_cast<Score>(term_freqs[index] * weight);
+        }
+    }
+}
+
+#ifdef SEARCH_ENGINE_HAS_AVX_DISPATCH
+// The intrinsics start from _mm*_undefined_*(), which GCC reports as maybe uninitialized once inlined.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+// The _round_ forms with the current rounding mode are used instead of plain multiply and add:
+// those may be fused into one FMA under avx512f, which would round differently from the scalar code.
+
+__attribute__((target("avx512f")))
+void AddScoresAvx512(const int* document_ids, const double* term_freqs, size_t count, double weight, double* scores) {
+    const __m512d weights = _mm512_set1_pd(weight);
+    const __m512d zeros = _mm512_setzero_pd();
+    size_t index = 0;
+
+    // The last block is masked rather than left to the scalar code: inlined here, that one would be fused.
+    for (; index < count; index += 8) {
+        const __mmask8 tail_mask = count - index >= 8 ? 0xFF : static_cast<__mmask8>((1u << (count - index)) - 1);
+        const __m512d block_term_freqs = _mm512_maskz_loadu_pd(tail_mask, term_freqs + index);
+        const __mmask8 mask = _mm512_mask_cmp_pd_mask(tail_mask, block_term_freqs, zeros, _CMP_GE_OQ);
+        const __m256i ids = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, document_ids + index));
+        const __m512d products = _mm512_mul_round_pd(block_term_freqs, weights, _MM_FROUND_CUR_DIRECTION);
+        const __m512d block = _mm512_max_pd(_mm512_mask_i32gather_pd(zeros, mask, ids, scores, sizeof(double)), zeros);
+        _mm512_mask_i32scatter_pd(scores, mask, ids, _mm512_add_round_pd(block, products, _MM_FROUND_CUR_DIRECTION),
+                                  sizeof(double));
+    }
+}
+
+__attribute__((target("avx512f")))
+void AddScoresAvx512(const int* document_ids, const double* term_freqs, size_t count, double weight, float* scores) {
+    const __m512d weights = _mm512_set1_pd(weight);
+    const __m512 zeros = _mm512_setzero_ps();
+    size_t index = 0;
+
+    for (; index + 16 <= count; index += 16) {
+        const __m512i ids = _mm512_loadu_si512(document_ids + index);
+        const __m512d low_term_freqs = _mm512_loadu_pd(term_freqs + index);
+        const __m512d high_term_freqs = _mm512_loadu_pd(term_freqs + index + 8);
+        const __mmask16 mask = static_cast<__mmask16>(
+            _mm512_cmp_pd_mask(low_term_freqs, _mm512_setzero_pd(), _CMP_GE_OQ)
+            | (_mm512_cmp_pd_mask(high_term_freqs, _mm512_setzero_pd(), _CMP_GE_OQ) << 8));
+        const __m256 low_products = _mm512_cvtpd_ps(
+            _mm512_mul_round_pd(low_term_freqs, weights, _MM_FROUND_CUR_DIRECTION));
+        const __m256 high_products = _mm512_cvtpd_ps(
+            _mm512_mul_round_pd(high_term_freqs, weights, _MM_FROUND_CUR_DIRECTION));
+        const __m512 products = _mm512_castpd_ps(_mm512_insertf64x4(
+            _mm512_castps_pd(_mm512_castps256_ps512(low_products)), _mm256_castps_pd(high_products), 1));
+        const __m512 block = _mm512_max_ps(_mm512_mask_i32gather_ps(zeros, mask, ids, scores, sizeof(float)), zeros);
+        _mm512_mask_i32scatter_ps(scores, mask, ids, _mm512_add_round_ps(block, products, _MM_FROUND_CUR_DIRECTION),
+                                  sizeof(float));
+    }
+
+    AddScoresScalar(document_ids + index, term_freqs + index, count - index, weight, scores);
+}
+
+// AVX2 has gathers but no scatters: the updated block is written back one lane at a time. For doubles that is
+// slower than the scalar code, so there is no AVX2 version of them.
+__attribute__((target("avx2")))
+void AddScoresAvx2(const int* document_ids, const double* term_freqs, size_t count, double weight, float* scores) {
+    const __m256d weights = _mm256_set1_pd(weight);
+    const __m256 zeros = _mm256_setzero_ps();
+    alignas(32) float updated[8];
+    size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        const __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(document_ids + index));
+        const __m128 low_products = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_loadu_pd(term_freqs + index), weights));
+        const __m128 high_products = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_loadu_pd(term_freqs + index + 4), weights));
+        const __m256 block = _mm256_max_ps(_mm256_i32gather_ps(scores, ids, sizeof(float)), zeros);
+        _mm256_store_ps(updated, _mm256_add_ps(block, _mm256_set_m128(high_products, low_products)));
+        for (size_t lane = 0; lane < 8; ++lane) {
+            if (term_freqs[index + lane] >= 0) {
+                scores[document_ids[index + lane]] = updated[lane];
+            }
+        }
+    }
+
+    AddScoresScalar(document_ids + index, term_freqs + index, count - index, weight, scores);
+}
+
+#pragma GCC diagnostic pop
+
+const bool kHasAvx512 = __builtin_cpu_supports("avx512f");
+const bool kHasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+} //namespace
+
+void scoring_kernels::AddScores(const int* document_ids, const double* term_freqs, size_t count, double weight,
+                                double* scores) {
+#ifdef SEARCH_ENGINE_HAS_AVX_DISPATCH
+    if (kHasAvx512) {
+        return AddScoresAvx512(document_ids, term_freqs, count, weight, scores);
+    }
+#endif
+
+    AddScoresScalar(document_ids, term_freqs, count, weight, scores);
+}
+
+void scoring_kernels::AddScores(const int* document_ids, const double* term_freqs, size_t count, double weight,
+                                float* scores) {
+#ifdef SEARCH_ENGINE_HAS_AVX_DISPATCH
+    if (kHasAvx512) {
+        return AddScoresAvx512(document_ids, term_freqs, count, weight, scores);
+    }
+    if (kHasAvx2) {
+        return AddScoresAvx2(document_ids, term_freqs, count, weight, scores);
+    }
+#endif
+
+    AddScoresScalar(document_ids, term_freqs, count, weight, scores);
+}
@@ -0,0 +1,1232 @@
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "document_reordering.h"
+#include "edit_distance_automaton.h"
+#include "scoring_kernels.h"
+#include "search_index.h"
+
+using namespace std::literals::string_literals;
+
+namespace {
+
+// Node sizes follow the libstdc++ layout: a tree node has a color and three pointers,
+// a hash node has one pointer to the next node.
+constexpr size_t kTreeNodeOverhead = 4 * sizeof(void*);
+constexpr size_t kHashNodeOverhead = sizeof(void*);
+
+template <typename Type>
+size_t GetHeapUsage(const Type& value);
+
+size_t GetHeapUsage(const std::string& text);
+
+template <typename Type>
+size_t GetHeapUsage(const std::vector<Type>& values);
+
+template <typename Key, typename Value, typename Compare>
+size_t GetHeapUsage(const std::map<Key, Value, Compare>& values);
+
+template <typename Key, typename Value>
+size_t GetHeapUsage(const std::unordered_map<Key, Value>& values);
+
+template <typename Key>
+size_t GetHeapUsage(const std::set<Key>& values);
+
+size_t GetHeapUsage(const PostingList& postings);
+
+template <typename Type>
+size_t GetHeapUsage(const Type&) {
+    return 0;
+}
+
+size_t GetHeapUsage(const std::string& text) {
+    const char* const object = reinterpret_cast<const char*>(&text);
+    const bool is_short = text.data() >= object && text.data() < object + sizeof(text);
+
+    return is_short ? 0 : text.capacity() + 1;
+}
+
+size_t GetHeapUsage(const PostingList& postings) {
+    return postings.GetMemoryUsage();
+}
+
+template <typename First, typename Second>
+size_t GetPairHeapUsage(const std::pair<First, Second>& value) {
+    return GetHeapUsage(value.first) + GetHeapUsage(value.second);
+}
+
+template <typename Type>
+size_t GetHeapUsage(const std::vector<Type>& values) {
+    size_t usage = values.capacity() * sizeof(Type);
+    for (const Type& value : values) {
+        usage += GetHeapUsage(value);
+    }
+
+    return usage;
+}
+
+template <typename Key, typename Value, typename Compare>
+size_t GetHeapUsage(const std::map<Key, Value, Compare>& values) {
+    size_t usage = values.size() * (kTreeNodeOverhead + sizeof(std::pair<const Key, Value>));
+    for (const auto& value : values) {
+        usage += GetPairHeapUsage(value);
+    }
+
+    return usage;
+}
+
+template <typename Key, typename Value>
+size_t GetHeapUsage(const std::unordered_map<Key, Value>& values) {
+    size_t usage = values.bucket_count() * sizeof(void*)
+        + values.size() * (kHashNodeOverhead + sizeof(std::pair<const Key, Value>));
+    for (const auto& value : values) {
+        usage += GetPairHeapUsage(value);
+    }
+
+    return usage;
+}
+
+template <typename Key>
+size_t GetHeapUsage(const std::set<Key>& values) {
+    size_t usage = values.size() * (kTreeNodeOverhead + sizeof(Key));
+    for (const Key& value : values) {
+        usage += GetHeapUsage(value);
+    }
+
+    return usage;
+}
+
+// Cursors for EditDistanceAutomaton::Walk.
+class DictionaryCursor {
+public:
+    explicit DictionaryCursor(const TermDictionary& dictionary) : dictionary_(dictionary), term_(dictionary.begin()) {
+    }
+
+public:
+    [[nodiscard]] bool IsEnd() const {
+        return term_.IsEnd();
+    }
+
+    [[nodiscard]] std::string_view GetTerm() const {
+        return term_.GetTerm();
+    }
+
+    [[nodiscard]] int GetTermId() const {
+        return term_.GetTermId();
+    }
+
+    void Next() {
+        term_.Next();
+    }
+
+    void Seek(std::string_view term) {
+        term_ = dictionary_.LowerBound(term);
+    }
+
+private:
+    const TermDictionary& dictionary_;
+    TermDictionary::Iterator term_;
+};
+
+class RecentTermsCursor {
+public:
+    explicit RecentTermsCursor(const std::map<std::string, int, std::less<>>& terms) : terms_(terms), term_(terms.begin()) {
+    }
+
+public:
+    [[nodiscard]] bool IsEnd() const {
+        return term_ == terms_.end();
+    }
+
+    [[nodiscard]] std::string_view GetTerm() const {
+        return term_->first;
+    }
+
+    [[nodiscard]] int GetTermId() const {
+        return term_->second;
+    }
+
+    void Next() {
+        ++term_;
+    }
+
+    void Seek(std::string_view term) {
+        term_ = terms_.lower_bound(term);
+    }
+
+private:
+    const std::map<std::string, int, std::less<>>& terms_;
+    std::map<std::string, int, std::less<>>::const_iterator term_;
+};
+
+} //namespace
+
+size_t SearchIndex::MemoryUsage::GetTotal() const {
+    return term_dictionary + postings + forward_index + attributes + document_ids;
+}
+
+std::ostream& operator<<(std::ostream& output, const SearchIndex::MemoryUsage& memory_usage) {
+    return output << "term dictionary = "s << memory_usage.term_dictionary << ", "s
+                  << "postings = "s << memory_usage.postings << ", "s
+                  << "forward index = "s << memory_usage.forward_index << ", "s
+                  << "attributes = "s << memory_usage.attributes << ", "s
+                  << "document IDs = "s << memory_usage.document_ids << ", "s
+                  << "total = "s << memory_usage.GetTotal() << " bytes"s << std::endl;
+}
+
+SearchIndex::SearchIndex(ForwardIndexMode forward_index_mode) : forward_index_mode_(forward_index_mode) {
+}
+
+SearchIndex::RecentTerms::RecentTerms(const RecentTerms& other) : ids(other.ids), first_term_id(other.first_term_id) {
+    words.resize(ids.size());
+    for (const auto& [word, term_id] : ids) {
+        words[term_id - first_term_id] = word;
+    }
+}
+
+SearchIndex::RecentTerms& SearchIndex::RecentTerms::operator=(const RecentTerms& other) {
+    if (this != &other) {
+        *this = RecentTerms(other);
+    }
+
+    return *this;
+}
+
+void SearchIndex::AddDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+                              const std::vector<int>& ratings) {
+    if (document_id < 0 || internal_ids_.count(document_id)) {
+	throw std::invalid_argument("ID of the document is negative or already linked to another document.");
+    }
+
+    const int internal_id = static_cast<int>(external_ids_.size());
+    std::map<std::string, double> word_frequencies = ComputeWordFrequencies(words);
+    const size_t term_offset = document_terms_.size();
+
+    for (const auto& [word, term_freq] : word_frequencies) {
+    	const int term_id = AddTerm(word);
+    	document_to_word_frequency_[term_id].Append(internal_id, term_freq);
+    	if (forward_index_mode_ == ForwardIndexMode::kTermIds) {
+    	    document_terms_.push_back(term_id);
+    	}
+    }
+
+    if (forward_index_mode_ == ForwardIndexMode::kTermIds) {
+    	document_term_spans_.push_back({term_offset, document_terms_.size() - term_offset});
+    } else {
+    	id_to_word_frequency_.push_back(std::move(word_frequencies));
+    }
+
+    const int rating = ComputeAverageRating(ratings);
+
+    external_ids_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    for (Bitmap& documents : status_documents_) {
+    	documents.Resize(external_ids_.size());
+    }
+    rating_positions_.push_back(0);
+    IndexAttributes(internal_id);
+
+    internal_ids_.emplace(document_id, internal_id);
+    document_ids_.insert(document_id);
+
+    if (recent_terms_.ids.size() >= std::max(kMinRecentTermsToCompact, term_dictionary_.GetTermCount() / 8)) {
+    	CompactTermDictionary();
+    }
+}
+
+void SearchIndex::RemoveDocument(int document_id) {
+    const int internal_id = FindInternalId(document_id);
+
+    if (forward_index_mode_ == ForwardIndexMode::kTermIds) {
+    	TermSpan& span = document_term_spans_[internal_id];
+    	for (size_t term = span.offset; term < span.offset + span.size; ++term) {
+    	    document_to_word_frequency_[document_terms_[term]].Erase(internal_id);
+    	}
+    	stale_term_count_ += span.size;
+    	span = TermSpan();
+    	CompactForwardIndex();
+    } else {
+    	for (const auto& word_to_frequency : id_to_word_frequency_[internal_id]) {
+    	    document_to_word_frequency_[FindTermId(word_to_frequency.first)].Erase(internal_id);
+    	}
+    	id_to_word_frequency_[internal_id].clear();
+    }
+
+    UnindexAttributes(internal_id);
+
+    internal_ids_.erase(document_id);
+    document_ids_.erase(document_id);
+}
+
+void SearchIndex::UpdateDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+                                 const std::vector<int>& ratings) {
+    const int internal_id = FindInternalId(document_id);
+    std::map<std::string, double> word_frequencies = ComputeWordFrequencies(words);
+
+    // (term ID, term frequency) of the old and the new text, compared in the order of term IDs.
+    std::vector<std::pair<int, double>> old_terms;
+    if (forward_index_mode_ == ForwardIndexMode::kTermIds) {
+    	const TermSpan span = document_term_spans_[internal_id];
+    	for (size_t term = span.offset; term < span.offset + span.size; ++term) {
+    	    const int term_id = document_terms_[term];
+    	    old_terms.emplace_back(term_id, *document_to_word_frequency_[term_id].FindTermFreq(internal_id));
+    	}
+    } else {
+    	for (const auto& [word, term_freq] : id_to_word_frequency_[internal_id]) {
+    	    old_terms.emplace_back(FindTermId(word), term_freq);
+    	}
+    }
+
+    std::vector<std::pair<int, double>> new_terms;
+    std::vector<int> new_term_ids;
+    for (const auto& [word, term_freq] : word_frequencies) {
+    	new_terms.emplace_back(AddTerm(word), term_freq);
+    	new_term_ids.push_back(new_terms.back().first);
+    }
+
+    std::sort(old_terms.begin(), old_terms.end());
+    std::sort(new_terms.begin(), new_terms.end());
+
+    auto old_term = old_terms.begin();
+    auto new_term = new_terms.begin();
+    bool is_term_set_changed = false;
+
+    while (old_term != old_terms.end() || new_term != new_terms.end()) {
+    	if (new_term == new_terms.end() || (old_term != old_terms.end() && old_term->first < new_term->first)) {
+    	    document_to_word_frequency_[old_term->first].Erase(internal_id);
+    	    is_term_set_changed = true;
+    	    ++old_term;
+    	} else if (old_term == old_terms.end() || new_term->first < old_term->first) {
+    	    document_to_word_frequency_[new_term->first].Set(internal_id, new_term->second);
+    	    is_term_set_changed = true;
+    	    ++new_term;
+    	} else {
+    	    if (old_term->second != new_term->second) {
+    	        document_to_word_frequency_[new_term->first].Set(internal_id, new_term->second);
+    	    }
+    	    ++old_term;
+    	    ++new_term;
+    	}
+    }
+
+    if (forward_index_mode_ == ForwardIndexMode::kWordFrequencies) {
+    	id_to_word_frequency_[internal_id] = std::move(word_frequencies);
+    } else if (is_term_set_changed) {
+    	// New terms that fit replace the old ones in place, the others go to the end. Either way the
+    	// terms of other documents stay where they are.
+    	TermSpan& span = document_term_spans_[internal_id];
+    	if (new_term_ids.size() <= span.size) {
+    	    std::copy(new_term_ids.begin(), new_term_ids.end(), document_terms_.begin() + static_cast<std::ptrdiff_t>(span.offset));
+    	    stale_term_count_ += span.size - new_term_ids.size();
+    	    span.size = new_term_ids.size();
+    	} else {
+    	    stale_term_count_ += span.size;
+    	    span = {document_terms_.size(), new_term_ids.size()};
+    	    document_terms_.insert(document_terms_.end(), new_term_ids.begin(), new_term_ids.end());
+    	}
+    	CompactForwardIndex();
+    }
+
+    UpdateAttributes(document_id, status, ratings);
+
+    if (recent_terms_.ids.size() >= std::max(kMinRecentTermsToCompact, term_dictionary_.GetTermCount() / 8)) {
+    	CompactTermDictionary();
+    }
+}
+
+void SearchIndex::UpdateAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings) {
+    const int internal_id = FindInternalId(document_id);
+    const int rating = ComputeAverageRating(ratings);
+
+    // A status flip alone does not touch the rating index.
+    if (rating != ratings_[internal_id]) {
+        UnindexAttributes(internal_id);
+        ratings_[internal_id] = rating;
+        statuses_[internal_id] = status;
+        IndexAttributes(internal_id);
+    } else if (status != statuses_[internal_id]) {
+        status_documents_[static_cast<size_t>(statuses_[internal_id])].Reset(internal_id);
+        statuses_[internal_id] = status;
+        status_documents_[static_cast<size_t>(status)].Set(internal_id);
+    }
+}
+
+std::vector<Document> SearchIndex::FindTopDocuments(const Query& query, const DocumentFilter& filter) const {
+    QueryExecution execution = StartQuery(query, filter);
+    execution.Step(SIZE_MAX);
+
+    return SelectTopDocuments(execution.TakeMatchedDocuments());
+}
+
+std::vector<Document> SearchIndex::FindTopDocuments(const Query& query, DocumentStatus status) const {
+    return FindTopDocuments(query, DocumentFilter{.status = status});
+}
+
+std::vector<Document> SearchIndex::FindTopDocuments(const Query& query) const {
+    return FindTopDocuments(query, DocumentStatus::kActual);
+}
+
+TopDocuments SearchIndex::FindTopDocuments(const Query& query, const DocumentFilter& filter,
+                                           const QueryBudget& budget) const {
+    QueryExecution execution = StartQuery(query, filter, true);
+    TopDocuments top_documents;
+
+    const auto next_block_size = [&] {
+        return std::min(kPostingsPerBlock, budget.max_postings - execution.GetScoredPostingCount());
+    };
+
+    while (!execution.Step(next_block_size())) {
+        if (execution.GetScoredPostingCount() >= budget.max_postings
+            || std::chrono::steady_clock::now() >= budget.deadline) {
+            execution.Stop();
+            top_documents.is_partial = true;
+            break;
+        }
+    }
+
+    top_documents.scored_posting_count = execution.GetScoredPostingCount();
+    top_documents.documents = SelectTopDocuments(execution.TakeMatchedDocuments());
+
+    return top_documents;
+}
+
+TopDocuments SearchIndex::FindTopDocuments(const Query& query, DocumentStatus status, const QueryBudget& budget) const {
+    return FindTopDocuments(query, DocumentFilter{.status = status}, budget);
+}
+
+TopDocuments SearchIndex::FindTopDocuments(const Query& query, const QueryBudget& budget) const {
+    return FindTopDocuments(query, DocumentStatus::kActual, budget);
+}
+
+QueryFuture<std::vector<Document>> SearchIndex::FindTopDocumentsAsync(QueryPriority priority, const Query& query,
+                                                                      const DocumentFilter& filter) const {
+    return RunAsync(priority, StartQuery(query, filter), [this](std::vector<Document> matched_documents) {
+        return SelectTopDocuments(std::move(matched_documents));
+    });
+}
+
+QueryFuture<std::vector<Document>> SearchIndex::FindTopDocumentsAsync(QueryPriority priority, const Query& query,
+                                                                      DocumentStatus status) const {
+    return FindTopDocumentsAsync(priority, query, DocumentFilter{.status = status});
+}
+
+QueryFuture<std::vector<Document>> SearchIndex::FindTopDocumentsAsync(QueryPriority priority, const Query& query) const {
+    return FindTopDocumentsAsync(priority, query, DocumentStatus::kActual);
+}
+
+QueryFuture<std::tuple<std::vector<std::string>, DocumentStatus>> SearchIndex::MatchDocumentAsync(
+    QueryPriority priority, Query query, int document_id) const {
+    QueryPromise<std::tuple<std::vector<std::string>, DocumentStatus>> promise;
+    auto shared_query = std::make_shared<Query>(std::move(query));
+
+    GetQueryExecutor().Submit(priority, [this, promise, shared_query, document_id]() mutable {
+        try {
+            promise.SetValue(MatchDocument(*shared_query, document_id));
+        } catch (...) {
+            promise.SetException(std::current_exception());
+        }
+
+        return true;
+    });
+
+    return promise.GetFuture();
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> SearchIndex::MatchDocument(const Query& query, int document_id) const {
+    const int internal_id = FindInternalId(document_id);
+
+    std::vector<std::string> matched_words;
+
+    for (const std::string& word : query.required_words) {
+        const int term_id = FindTermId(word);
+        if (term_id == TermDictionary::kNotFound || !document_to_word_frequency_[term_id].Contains(internal_id)) {
+            return {std::vector<std::string>{}, statuses_[internal_id]};
+        }
+
+        matched_words.push_back(word);
+    }
+
+    for (const std::string& word : query.plus_words) {
+        const int term_id = FindTermId(word);
+        if (term_id == TermDictionary::kNotFound) {
+            continue;
+        }
+
+        if (document_to_word_frequency_[term_id].Contains(internal_id)) {
+            matched_words.push_back(word);
+        }
+    }
+
+    for (const auto& [word, _] : query.typo_words) {
+        const int term_id = FindTermId(word);
+        if (term_id != TermDictionary::kNotFound && document_to_word_frequency_[term_id].Contains(internal_id)) {
+            matched_words.push_back(word);
+        }
+    }
+
+    if (!query.required_words.empty() || !query.typo_words.empty()) {
+        std::sort(matched_words.begin(), matched_words.end());
+    }
+
+    for (const std::string& word : query.minus_words) {
+        const int term_id = FindTermId(word);
+        if (term_id == TermDictionary::kNotFound) {
+            continue;
+        }
+
+        if (document_to_word_frequency_[term_id].Contains(internal_id)) {
+            matched_words.clear();
+            break;
+        }
+    }
+
+    return {matched_words, statuses_[internal_id]};
+}
+
+int SearchIndex::GetDocumentCount() const {
+    return static_cast<int>(internal_ids_.size());
+}
+
+std::set<int>::const_iterator SearchIndex::begin() const{
+    return document_ids_.cbegin();
+}
+
+std::set<int>::const_iterator SearchIndex::end() const{
+    return document_ids_.cend();
+}
+
+std::map<std::string, double> SearchIndex::GetWordFrequencies(int document_id) const {
+    if (!document_ids_.count(document_id)) {
+        return {};
+    }
+
+    const int internal_id = FindInternalId(document_id);
+
+    if (forward_index_mode_ == ForwardIndexMode::kWordFrequencies) {
+        return id_to_word_frequency_[internal_id];
+    }
+
+    std::map<std::string, double> word_frequencies;
+
+    const TermSpan span = document_term_spans_[internal_id];
+    for (size_t term = span.offset; term < span.offset + span.size; ++term) {
+        const int term_id = document_terms_[term];
+        const double term_freq = *document_to_word_frequency_[term_id].FindTermFreq(internal_id);
+        // Words added after the last compaction have no reverse mapping in the dictionary yet.
+        if (term_id >= recent_terms_.first_term_id) {
+            word_frequencies.emplace(recent_terms_.words[term_id - recent_terms_.first_term_id], term_freq);
+        } else {
+            word_frequencies.emplace(term_dictionary_.GetTerm(term_id), term_freq);
+        }
+    }
+
+    return word_frequencies;
+}
+
+ForwardIndexMode SearchIndex::GetForwardIndexMode() const {
+    return forward_index_mode_;
+}
+
+SearchIndex::MemoryUsage SearchIndex::GetMemoryUsage() const {
+    MemoryUsage memory_usage;
+
+    memory_usage.term_dictionary = term_dictionary_.GetMemoryUsage() + GetHeapUsage(recent_terms_.ids)
+        + GetHeapUsage(recent_terms_.words);
+    memory_usage.postings = GetHeapUsage(document_to_word_frequency_);
+    memory_usage.forward_index = GetHeapUsage(id_to_word_frequency_) + GetHeapUsage(document_terms_)
+        + GetHeapUsage(document_term_spans_);
+
+    memory_usage.attributes = GetHeapUsage(ratings_) + GetHeapUsage(statuses_) + GetHeapUsage(rating_index_)
+        + GetHeapUsage(rating_positions_);
+    for (const Bitmap& documents : status_documents_) {
+        memory_usage.attributes += documents.GetMemoryUsage();
+    }
+
+    memory_usage.document_ids = GetHeapUsage(external_ids_) + GetHeapUsage(internal_ids_) + GetHeapUsage(document_ids_);
+
+    return memory_usage;
+}
+
+void SearchIndex::ReorderDocuments() {
+    const size_t slot_count = external_ids_.size();
+
+    // Live documents get dense local numbers, removed ones keep -1.
+    std::vector<int> local_ids(slot_count, -1);
+    std::vector<int> local_to_internal;
+    for (size_t internal_id = 0; internal_id < slot_count; ++internal_id) {
+        if (const auto document = internal_ids_.find(external_ids_[internal_id]);
+            document != internal_ids_.end() && document->second == static_cast<int>(internal_id)) {
+            local_ids[internal_id] = static_cast<int>(local_to_internal.size());
+            local_to_internal.push_back(static_cast<int>(internal_id));
+        }
+    }
+
+    // Words of a single document do not affect gaps, only the others take part.
+    std::vector<std::vector<int>> document_terms(local_to_internal.size());
+    size_t shared_term_count = 0;
+    for (const PostingList& postings : document_to_word_frequency_) {
+        if (postings.GetSize() < 2) {
+            continue;
+        }
+
+        for (size_t posting = 0; posting < postings.GetDocumentIds().size(); ++posting) {
+            if (!PostingList::IsErased(postings.GetTermFreqs()[posting])) {
+                const int internal_id = postings.GetDocumentIds()[posting];
+                document_terms[local_ids[internal_id]].push_back(static_cast<int>(shared_term_count));
+            }
+        }
+        ++shared_term_count;
+    }
+
+    const std::vector<int> order = document_reordering::ComputeBisectionOrder(document_terms, shared_term_count);
+    document_terms.clear();
+
+    std::vector<int> new_internal_ids(slot_count, -1);
+    for (size_t new_internal_id = 0; new_internal_id < order.size(); ++new_internal_id) {
+        new_internal_ids[local_to_internal[order[new_internal_id]]] = static_cast<int>(new_internal_id);
+    }
+
+    for (PostingList& postings : document_to_word_frequency_) {
+        std::vector<std::pair<int, double>> renumbered_postings;
+        renumbered_postings.reserve(postings.GetSize());
+        for (size_t posting = 0; posting < postings.GetDocumentIds().size(); ++posting) {
+            if (!PostingList::IsErased(postings.GetTermFreqs()[posting])) {
+                renumbered_postings.emplace_back(new_internal_ids[postings.GetDocumentIds()[posting]],
+                                                 postings.GetTermFreqs()[posting]);
+            }
+        }
+        std::sort(renumbered_postings.begin(), renumbered_postings.end());
+
+        postings = PostingList();
+        for (const auto& [internal_id, term_freq] : renumbered_postings) {
+            postings.Append(internal_id, term_freq);
+        }
+    }
+
+    std::vector<std::map<std::string, double>> id_to_word_frequency;
+    std::vector<int> document_terms_by_id;
+    std::vector<TermSpan> document_term_spans;
+    std::vector<int> external_ids;
+    std::vector<int> ratings;
+    std::vector<DocumentStatus> statuses;
+
+    for (const int local_id : order) {
+        const int internal_id = local_to_internal[local_id];
+
+        if (forward_index_mode_ == ForwardIndexMode::kTermIds) {
+            const TermSpan span = document_term_spans_[internal_id];
+            document_term_spans.push_back({document_terms_by_id.size(), span.size});
+            document_terms_by_id.insert(document_terms_by_id.end(), document_terms_.begin() + span.offset,
+                                        document_terms_.begin() + span.offset + span.size);
+        } else {
+            id_to_word_frequency.push_back(std::move(id_to_word_frequency_[internal_id]));
+        }
+
+        external_ids.push_back(external_ids_[internal_id]);
+        ratings.push_back(ratings_[internal_id]);
+        statuses.push_back(statuses_[internal_id]);
+    }
+
+    id_to_word_frequency_ = std::move(id_to_word_frequency);
+    document_terms_ = std::move(document_terms_by_id);
+    document_term_spans_ = std::move(document_term_spans);
+    stale_term_count_ = 0;
+    external_ids_ = std::move(external_ids);
+    ratings_ = std::move(ratings);
+    statuses_ = std::move(statuses);
+
+    status_documents_.fill(Bitmap(external_ids_.size()));
+    rating_index_.clear();
+    rating_positions_.resize(external_ids_.size());
+    internal_ids_.clear();
+    for (size_t internal_id = 0; internal_id < external_ids_.size(); ++internal_id) {
+        IndexAttributes(static_cast<int>(internal_id));
+        internal_ids_.emplace(external_ids_[internal_id], static_cast<int>(internal_id));
+    }
+}
+
+void SearchIndex::SetMaxTypoDistance(int max_typo_distance) {
+    if (max_typo_distance < 0) {
+        throw std::invalid_argument("Typo distance must not be negative."s);
+    }
+
+    max_typo_distance_ = std::min(max_typo_distance, kMaxTypoDistance);
+}
+
+void SearchIndex::SetScorePrecision(ScorePrecision score_precision) {
+    score_precision_ = score_precision;
+}
+
+void SearchIndex::SetQueryExecutor(QueryExecutor* query_executor) {
+    query_executor_ = query_executor;
+}
+
+void SearchIndex::CompactTermDictionary() {
+    if (recent_terms_.ids.empty()) {
+        return;
+    }
+
+    TermDictionary::Builder builder;
+    TermDictionary::Iterator old_term = term_dictionary_.begin();
+    auto recent_term = recent_terms_.ids.begin();
+
+    while (!old_term.IsEnd() || recent_term != recent_terms_.ids.end()) {
+        if (recent_term == recent_terms_.ids.end() || (!old_term.IsEnd() && old_term.GetTerm() < recent_term->first)) {
+            builder.Add(old_term.GetTerm(), old_term.GetTermId());
+            old_term.Next();
+        } else {
+            builder.Add(recent_term->first, recent_term->second);
+            ++recent_term;
+        }
+    }
+
+    term_dictionary_ = builder.Build();
+    recent_terms_ = RecentTerms();
+    recent_terms_.first_term_id = static_cast<int>(document_to_word_frequency_.size());
+}
+
+int SearchIndex::ComputeAverageRating(const std::vector<int>& ratings) {
+    if (ratings.empty()) {
+        return 0;
+    }
+
+    // Ratings come from clients, so their sum may not fit into int. The average always does.
+    int64_t rating_sum = 0;
+
+    for (const int rating : ratings) {
+        rating_sum += rating;
+    }
+
+    return static_cast<int>(rating_sum / static_cast<int64_t>(ratings.size()));
+}
+
+std::map<std::string, double> SearchIndex::ComputeWordFrequencies(const std::vector<std::string_view>& words) {
+    if (words.empty()) {
+        throw std::invalid_argument("The document has no words other than stop words."s);
+    }
+
+    const double inverted_word_count = 1.0 / words.size();
+    std::map<std::string, double> word_frequencies;
+
+    for (const std::string_view word : words) {
+        const auto [word_frequency, _] = word_frequencies.emplace(word, 0.0);
+        word_frequency->second += inverted_word_count;
+    }
+
+    return word_frequencies;
+}
+
+void SearchIndex::CompactForwardIndex() {
+    if (stale_term_count_ * 2 <= document_terms_.size()) {
+        return;
+    }
+
+    std::vector<int> document_terms;
+    document_terms.reserve(document_terms_.size() - stale_term_count_);
+    for (TermSpan& span : document_term_spans_) {
+        const size_t offset = document_terms.size();
+        document_terms.insert(document_terms.end(), document_terms_.begin() + span.offset,
+                              document_terms_.begin() + span.offset + span.size);
+        span.offset = offset;
+    }
+
+    document_terms_ = std::move(document_terms);
+    stale_term_count_ = 0;
+}
+
+void SearchIndex::IndexAttributes(int internal_id) {
+    status_documents_[static_cast<size_t>(statuses_[internal_id])].Set(internal_id);
+
+    std::vector<int>& rated_documents = rating_index_[ratings_[internal_id]];
+    rating_positions_[internal_id] = rated_documents.size();
+    rated_documents.push_back(internal_id);
+}
+
+void SearchIndex::UnindexAttributes(int internal_id) {
+    status_documents_[static_cast<size_t>(statuses_[internal_id])].Reset(internal_id);
+
+    // The last document of the bucket takes the place of the removed one.
+    const auto rated_documents = rating_index_.find(ratings_[internal_id]);
+    std::vector<int>& documents = rated_documents->second;
+    const size_t position = rating_positions_[internal_id];
+    documents[position] = documents.back();
+    rating_positions_[documents[position]] = position;
+    documents.pop_back();
+    if (documents.empty()) {
+        rating_index_.erase(rated_documents);
+    }
+}
+
+int SearchIndex::FindInternalId(int document_id) const {
+    return internal_ids_.at(document_id);
+}
+
+int SearchIndex::FindTermId(std::string_view word) const {
+    if (const auto recent_term = recent_terms_.ids.find(word); recent_term != recent_terms_.ids.end()) {
+        return recent_term->second;
+    }
+
+    return term_dictionary_.Find(word);
+}
+
+int SearchIndex::AddTerm(std::string_view word) {
+    const int term_id = FindTermId(word);
+    if (term_id != TermDictionary::kNotFound) {
+        return term_id;
+    }
+
+    const int new_term_id = static_cast<int>(document_to_word_frequency_.size());
+    const auto [recent_term, _] = recent_terms_.ids.emplace(word, new_term_id);
+    recent_terms_.words.push_back(recent_term->first);
+    document_to_word_frequency_.emplace_back();
+
+    return new_term_id;
+}
+
+void SearchIndex::AddWordsWithPrefix(std::string_view prefix, std::set<std::string>& words) const {
+    for (TermDictionary::Iterator term = term_dictionary_.LowerBound(prefix);
+         !term.IsEnd() && term.GetTerm().substr(0, prefix.size()) == prefix; term.Next()) {
+        if (!document_to_word_frequency_[term.GetTermId()].IsEmpty()) {
+            words.emplace(term.GetTerm());
+        }
+    }
+
+    for (auto term = recent_terms_.ids.lower_bound(prefix);
+         term != recent_terms_.ids.end() && std::string_view(term->first).substr(0, prefix.size()) == prefix; ++term) {
+        if (!document_to_word_frequency_[term->second].IsEmpty()) {
+            words.insert(term->first);
+        }
+    }
+}
+
+void SearchIndex::AddWordsWithTypos(std::string_view word, std::map<std::string, double>& words) const {
+    if (max_typo_distance_ == 0) {
+        return;
+    }
+
+    if (const int term_id = FindTermId(word);
+        term_id != TermDictionary::kNotFound && !document_to_word_frequency_[term_id].IsEmpty()) {
+        return;
+    }
+
+    struct TypoWord {
+        int distance = 0;
+        size_t document_count = 0;
+        std::string word;
+    };
+
+    std::vector<TypoWord> typo_words;
+    EditDistanceAutomaton automaton(word, max_typo_distance_);
+
+    const auto walk = [&](auto& cursor) {
+        automaton.Walk(cursor, [&](int distance) {
+            const size_t document_count = document_to_word_frequency_[cursor.GetTermId()].GetSize();
+            if (document_count > 0) {
+                typo_words.push_back({distance, document_count, std::string(cursor.GetTerm())});
+            }
+        });
+    };
+
+    DictionaryCursor dictionary_term(term_dictionary_);
+    walk(dictionary_term);
+    RecentTermsCursor recent_term(recent_terms_.ids);
+    walk(recent_term);
+
+    // The closest and then the most common words are the most likely to be meant.
+    const size_t typo_word_count = std::min(typo_words.size(), kMaxTypoWordCount);
+    std::partial_sort(typo_words.begin(), typo_words.begin() + typo_word_count, typo_words.end(),
+        [](const TypoWord& left_hand_side, const TypoWord& right_hand_side) {
+            return std::tie(left_hand_side.distance, right_hand_side.document_count, left_hand_side.word)
+                < std::tie(right_hand_side.distance, left_hand_side.document_count, right_hand_side.word);
+        });
+
+    for (size_t index = 0; index < typo_word_count; ++index) {
+        const double weight = std::pow(kTypoWeight, typo_words[index].distance);
+        const auto [typo_word, is_inserted] = words.emplace(std::move(typo_words[index].word), weight);
+        if (!is_inserted) {
+            typo_word->second = std::max(typo_word->second, weight);
+        }
+    }
+}
+
+double SearchIndex::ComputeWordInverseDocumentFrequency(int term_id) const {
+    const size_t size_of_document_to_word_frequency = document_to_word_frequency_[term_id].GetSize();
+
+    if (size_of_document_to_word_frequency > 0) {
+        return log(GetDocumentCount() * 1.0 / size_of_document_to_word_frequency);
+    }
+
+    return 0;
+}
+
+SearchIndex::QueryExecution SearchIndex::StartQuery(const Query& query, const DocumentFilter& filter,
+                                                    bool is_selective_first) const {
+    QueryExecution execution;
+    execution.index_ = this;
+
+    if (filter.status) {
+        execution.status_documents_ = &status_documents_[static_cast<size_t>(*filter.status)];
+    }
+
+    execution.min_rating_ = filter.min_rating.value_or(INT_MIN);
+    execution.max_rating_ = filter.max_rating.value_or(INT_MAX);
+
+    if (execution.min_rating_ > execution.max_rating_) {
+        return execution;
+    }
+
+    if (filter.min_rating || filter.max_rating) {
+        const auto first_rating = rating_index_.lower_bound(execution.min_rating_);
+        const auto last_rating = rating_index_.upper_bound(execution.max_rating_);
+        const size_t max_selective_count = external_ids_.size() / kSelectiveRangeDivisor;
+
+        size_t rated_document_count = 0;
+        for (auto rating = first_rating; rating != last_rating && rated_document_count <= max_selective_count; ++rating) {
+            rated_document_count += rating->second.size();
+        }
+
+        if (rated_document_count <= max_selective_count) {
+            Bitmap& rated_documents = execution.rated_documents_.emplace(external_ids_.size());
+            for (auto rating = first_rating; rating != last_rating; ++rating) {
+                for (const int internal_id : rating->second) {
+                    rated_documents.Set(internal_id);
+                }
+            }
+
+            if (execution.status_documents_ != nullptr) {
+                rated_documents &= *execution.status_documents_;
+                execution.status_documents_ = nullptr;
+            }
+            execution.min_rating_ = INT_MIN;
+            execution.max_rating_ = INT_MAX;
+        }
+    }
+
+    using WordKind = QueryExecution::WordKind;
+
+    const auto by_posting_count = [this](const QueryExecution::Word& left, const QueryExecution::Word& right) {
+        return document_to_word_frequency_[left.term_id].GetSize() < document_to_word_frequency_[right.term_id].GetSize();
+    };
+
+    for (const std::string& word : query.required_words) {
+        const int term_id = FindTermId(word);
+        if (term_id == TermDictionary::kNotFound || document_to_word_frequency_[term_id].IsEmpty()) {
+            execution.words_.clear();
+            return execution;
+        }
+
+        execution.words_.push_back({term_id, WordKind::kRequired, ComputeWordInverseDocumentFrequency(term_id)});
+    }
+    std::stable_sort(execution.words_.begin(), execution.words_.end(), by_posting_count);
+
+    const size_t required_word_count = execution.words_.size();
+    execution.is_conjunctive_ = required_word_count > 0;
+
+    for (const std::string& word : query.plus_words) {
+        const int term_id = FindTermId(word);
+        if (term_id != TermDictionary::kNotFound) {
+            execution.words_.push_back({term_id, WordKind::kPlus, ComputeWordInverseDocumentFrequency(term_id)});
+        }
+    }
+
+    for (const auto& [word, weight] : query.typo_words) {
+        const int term_id = FindTermId(word);
+        if (term_id != TermDictionary::kNotFound) {
+            execution.words_.push_back({term_id, WordKind::kPlus, ComputeWordInverseDocumentFrequency(term_id) * weight});
+        }
+    }
+
+    if (is_selective_first) {
+        std::stable_sort(execution.words_.begin() + required_word_count, execution.words_.end(), by_posting_count);
+    }
+
+    if (!execution.is_conjunctive_) {
+        size_t plus_posting_count = 0;
+        for (const QueryExecution::Word& word : execution.words_) {
+            plus_posting_count += document_to_word_frequency_[word.term_id].GetSize();
+        }
+
+        const size_t score_size = score_precision_ == ScorePrecision::kFloat ? sizeof(float) : sizeof(double);
+        execution.needs_dense_scores_ = plus_posting_count > 0
+            && external_ids_.size() * score_size <= plus_posting_count * kMaxDenseScoreBytesPerPosting;
+    }
+
+    // Minus words go last: they are subtracted from the documents scored by the other words.
+    for (const std::string& word : query.minus_words) {
+        const int term_id = FindTermId(word);
+        if (term_id != TermDictionary::kNotFound) {
+            execution.words_.push_back({term_id, WordKind::kMinus, 0});
+        }
+    }
+
+    return execution;
+}
+
+QueryExecutor& SearchIndex::GetQueryExecutor() const {
+    return query_executor_ != nullptr ? *query_executor_ : QueryExecutor::GetDefault();
+}
+
+bool SearchIndex::QueryExecution::Step(size_t max_postings) {
+    size_t posting_count = 0;
+
+    while (word_ < words_.size()) {
+        if (posting_count >= max_postings) {
+            scored_posting_count_ += posting_count;
+            return false;
+        }
+
+        const Word& word = words_[word_];
+        const PostingList& postings = GetPostings(word);
+
+        if (word.kind == WordKind::kRequired && word_ == 0) {
+            // The shortest required list gives the candidates, the rest of the words are merged into them.
+            const std::vector<int>& document_ids = postings.GetDocumentIds();
+            const std::vector<double>& term_freqs = postings.GetTermFreqs();
+            const size_t last_posting = std::min(document_ids.size(), posting_ + (max_postings - posting_count));
+
+            posting_count += last_posting - posting_;
+            for (; posting_ < last_posting; ++posting_) {
+                if (!PostingList::IsErased(term_freqs[posting_]) && IsAllowed(document_ids[posting_])) {
+                    candidates_.push_back(document_ids[posting_]);
+                    relevances_.push_back(term_freqs[posting_] * word.inverse_document_freq);
+                }
+            }
+            is_collected_ = true;
+
+            if (posting_ < document_ids.size()) {
+                scored_posting_count_ += posting_count;
+                return false;
+            }
+
+            posting_ = 0;
+            ++word_;
+        } else if (word.kind == WordKind::kPlus && !is_conjunctive_) {
+            const size_t posting_end = postings.GetDocumentIds().size();
+            const size_t last_posting = std::min(posting_end, posting_ + (max_postings - posting_count));
+
+            posting_count += last_posting - posting_;
+            AddScores(word, posting_, last_posting);
+            posting_ = last_posting;
+
+            if (posting_ < posting_end) {
+                scored_posting_count_ += posting_count;
+                return false;
+            }
+
+            posting_ = 0;
+            ++word_;
+        } else {
+            CollectScores();
+            const size_t merged_count = std::min(candidates_.size() - candidate_, max_postings - posting_count);
+
+            posting_count += merged_count;
+            if (!MergeCandidates(word, merged_count)) {
+                scored_posting_count_ += posting_count;
+                return false;
+            }
+
+            ++word_;
+        }
+    }
+
+    CollectScores();
+    scored_posting_count_ += posting_count;
+
+    return true;
+}
+
+void SearchIndex::QueryExecution::Stop() {
+    CollectScores();
+
+    // Unless a merge is in progress, the word read in part is dropped: a plus word, or the first required word
+    // whose postings all candidates come from anyway.
+    if (candidate_ == 0) {
+        posting_ = 0;
+        if (word_ == 0 && is_conjunctive_) {
+            ++word_;
+        }
+    }
+
+    for (; word_ < words_.size(); ++word_) {
+        // A word merged in part is finished, so that no stale candidates are left.
+        if (words_[word_].kind != WordKind::kPlus || candidate_ > 0) {
+            MergeCandidates(words_[word_], candidates_.size());
+        }
+    }
+    posting_ = 0;
+}
+
+size_t SearchIndex::QueryExecution::GetScoredPostingCount() const {
+    return scored_posting_count_;
+}
+
+std::vector<Document> SearchIndex::QueryExecution::TakeMatchedDocuments() {
+    CollectScores();
+
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(candidates_.size());
+
+    for (size_t candidate = 0; candidate < candidates_.size(); ++candidate) {
+        matched_documents.push_back({
+            candidates_[candidate],
+            relevances_[candidate],
+	    index_->ratings_[candidates_[candidate]]
+        });
+    }
+    candidates_.clear();
+    relevances_.clear();
+
+    return matched_documents;
+}
+
+const PostingList& SearchIndex::QueryExecution::GetPostings(const Word& word) const {
+    return index_->document_to_word_frequency_[word.term_id];
+}
+
+bool SearchIndex::QueryExecution::MergeCandidates(const Word& word, size_t max_candidates) {
+    const PostingList& postings = GetPostings(word);
+    const std::vector<int>& document_ids = postings.GetDocumentIds();
+    const std::vector<double>& term_freqs = postings.GetTermFreqs();
+    const size_t last_candidate = std::min(candidates_.size(), candidate_ + max_candidates);
+
+    for (; candidate_ < last_candidate; ++candidate_) {
+        posting_ = posting_search::GallopTo(document_ids, posting_, candidates_[candidate_]);
+        const bool is_found = posting_ < document_ids.size() && document_ids[posting_] == candidates_[candidate_]
+            && !PostingList::IsErased(term_freqs[posting_]);
+
+        if (is_found ? word.kind == WordKind::kMinus : word.kind == WordKind::kRequired) {
+            continue;
+        }
+
+        candidates_[kept_count_] = candidates_[candidate_];
+        relevances_[kept_count_] = relevances_[candidate_];
+        if (is_found) {
+            relevances_[kept_count_] += term_freqs[posting_] * word.inverse_document_freq;
+        }
+        ++kept_count_;
+    }
+
+    if (candidate_ < candidates_.size()) {
+        return false;
+    }
+
+    candidates_.resize(kept_count_);
+    relevances_.resize(kept_count_);
+    candidate_ = 0;
+    kept_count_ = 0;
+    posting_ = 0;
+
+    return true;
+}
+
+void SearchIndex::QueryExecution::AddScores(const Word& word, size_t begin, size_t end) {
+    const PostingList& postings = GetPostings(word);
+    const int* document_ids = postings.GetDocumentIds().data();
+    const double* term_freqs = postings.GetTermFreqs().data();
+
+    if (needs_dense_scores_) {
+        needs_dense_scores_ = false;
+        if (index_->score_precision_ == ScorePrecision::kFloat) {
+            dense_float_scores_.assign(index_->external_ids_.size(), scoring_kernels::kUnscored);
+        } else {
+            dense_scores_.assign(index_->external_ids_.size(), scoring_kernels::kUnscored);
+        }
+    }
+
+    if (!dense_scores_.empty()) {
+        scoring_kernels::AddScores(document_ids + begin, term_freqs + begin, end - begin, word.inverse_document_freq,
+                                   dense_scores_.data());
+    } else if (!dense_float_scores_.empty()) {
+        scoring_kernels::AddScores(document_ids + begin, term_freqs + begin, end - begin, word.inverse_document_freq,
+                                   dense_float_scores_.data());
+    } else {
+        for (size_t posting = begin; posting < end; ++posting) {
+            if (!PostingList::IsErased(term_freqs[posting]) && IsAllowed(document_ids[posting])) {
+                document_to_relevance_[document_ids[posting]] += term_freqs[posting] * word.inverse_document_freq;
+            }
+        }
+    }
+}
+
+void SearchIndex::QueryExecution::CollectScores() {
+    if (is_collected_) {
+        return;
+    }
+
+    const auto collect_dense_scores = [this](auto& scores) {
+        for (size_t document_id = 0; document_id < scores.size(); ++document_id) {
+            if (scores[document_id] >= 0 && IsAllowed(static_cast<int>(document_id))) {
+                candidates_.push_back(static_cast<int>(document_id));
+                relevances_.push_back(scores[document_id]);
+            }
+        }
+        scores.clear();
+        scores.shrink_to_fit();
+    };
+
+    if (!dense_scores_.empty()) {
+        collect_dense_scores(dense_scores_);
+        is_collected_ = true;
+        return;
+    }
+    if (!dense_float_scores_.empty()) {
+        collect_dense_scores(dense_float_scores_);
+        is_collected_ = true;
+        return;
+    }
+
+    candidates_.reserve(document_to_relevance_.size());
+    relevances_.reserve(document_to_relevance_.size());
+    for (const auto& [document_id, relevance] : document_to_relevance_) {
+        candidates_.push_back(document_id);
+        relevances_.push_back(relevance);
+    }
+
+    document_to_relevance_.clear();
+    is_collected_ = true;
+}
+
+bool SearchIndex::QueryExecution::IsAllowed(int document_id) const {
+    if (status_documents_ != nullptr && !status_documents_->Test(document_id)) {
+        return false;
+    }
+
+    if (rated_documents_ && !rated_documents_->Test(document_id)) {
+        return false;
+    }
+
+    const int rating = index_->ratings_[document_id];
+    return rating >= min_rating_ && rating <= max_rating_;
+}
+
+std::vector<Document> SearchIndex::SelectTopDocuments(std::vector<Document> matched_documents) const {
+    const auto by_relevance = [](const Document& left_hand_side, const Document& right_hand_side) {
+        if (std::abs(left_hand_side.relevance - right_hand_side.relevance) < kCloseToZero) {
+            return left_hand_side.rating > right_hand_side.rating;
+        } else {
+            return left_hand_side.relevance > right_hand_side.relevance;
+        }
+    };
+
+    if (static_cast<int>(matched_documents.size()) > kMaxResultDocumentCount) {
+        std::partial_sort(matched_documents.begin(), matched_documents.begin() + kMaxResultDocumentCount,
+            matched_documents.end(), by_relevance);
+        matched_documents.resize(static_cast<size_t>(kMaxResultDocumentCount));
+    } else {
+        std::sort(matched_documents.begin(), matched_documents.end(), by_relevance);
+    }
+
+    for (Document& document : matched_documents) {
+        document.id = external_ids_[document.id];
+    }
+
+    return matched_documents;
+}
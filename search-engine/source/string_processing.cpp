@@ -20,3 +20,19 @@ std::vector<std::string> string_processing::SplitIntoWords(const std::string& te
 
     return words;
 }
+
+std::vector<std::string_view> string_processing::SplitIntoWordViews(std::string_view text) {
+    std::vector<std::string_view> words;
+
+    size_t word_begin = 0;
+
+    for (size_t position = 0; position < text.size(); ++position) {
+        if (text[position] == ' ') {
+            words.push_back(text.substr(word_begin, position - word_begin));
+            word_begin = position + 1;
+        }
+    }
+    words.push_back(text.substr(word_begin));
+
+    return words;
+}
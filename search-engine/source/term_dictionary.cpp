@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "term_dictionary.h"
+
+using namespace std::literals::string_literals;
+
+namespace {
+
+void WriteVarint(std::string& output, uint64_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+uint64_t ReadVarint(const std::string& input, size_t& position) {
+    uint64_t value = 0;
+
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(input[position++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+} //namespace
+
+int TermDictionary::Find(std::string_view term) const {
+    const Iterator iterator = LowerBound(term);
+
+    if (!iterator.IsEnd() && iterator.GetTerm() == term) {
+        return iterator.GetTermId();
+    }
+
+    return kNotFound;
+}
+
+TermDictionary::Iterator TermDictionary::LowerBound(std::string_view term) const {
+    size_t first_block = 0;
+    size_t last_block = block_offsets_.size();
+
+    while (last_block - first_block > 1) {
+        const size_t middle_block = first_block + (last_block - first_block) / 2;
+        if (GetBlockHead(middle_block) <= term) {
+            first_block = middle_block;
+        } else {
+            last_block = middle_block;
+        }
+    }
+
+    Iterator iterator(*this, first_block);
+    while (!iterator.IsEnd() && iterator.GetTerm() < term) {
+        iterator.Next();
+    }
+
+    return iterator;
+}
+
+TermDictionary::Iterator TermDictionary::begin() const {
+    return Iterator(*this, 0);
+}
+
+bool TermDictionary::ContainsTermId(int term_id) const {
+    return term_id >= 0 && static_cast<size_t>(term_id) < term_id_to_ordinal_.size()
+        && term_id_to_ordinal_[term_id] != kNoOrdinal;
+}
+
+std::string TermDictionary::GetTerm(int term_id) const {
+    if (!ContainsTermId(term_id)) {
+        throw std::out_of_range("Unknown term ID."s);
+    }
+
+    const size_t ordinal = term_id_to_ordinal_[term_id];
+    Iterator iterator(*this, ordinal / kBlockSize);
+    for (size_t index = 0; index < ordinal % kBlockSize; ++index) {
+        iterator.Next();
+    }
+
+    return std::string(iterator.GetTerm());
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return term_count_;
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    return data_.capacity()
+        + block_offsets_.capacity() * sizeof(uint64_t)
+        + term_id_to_ordinal_.capacity() * sizeof(uint32_t);
+}
+
+std::string_view TermDictionary::GetBlockHead(size_t block) const {
+    size_t position = block_offsets_[block];
+    ReadVarint(data_, position);
+    const size_t size = ReadVarint(data_, position);
+
+    return std::string_view(data_).substr(position, size);
+}
+
+void TermDictionary::Builder::Add(std::string_view term, int term_id) {
+    TermDictionary& dictionary = dictionary_;
+
+    if (dictionary.term_count_ > 0 && term <= previous_term_) {
+        throw std::invalid_argument("Terms must be added in strictly increasing order."s);
+    }
+    if (term_id < 0) {
+        throw std::invalid_argument("Term ID is negative."s);
+    }
+
+    size_t shared_size = 0;
+    if (dictionary.term_count_ % kBlockSize == 0) {
+        dictionary.block_offsets_.push_back(dictionary.data_.size());
+    } else {
+        const size_t max_shared_size = std::min(term.size(), previous_term_.size());
+        while (shared_size < max_shared_size && term[shared_size] == previous_term_[shared_size]) {
+            ++shared_size;
+        }
+    }
+
+    WriteVarint(dictionary.data_, shared_size);
+    WriteVarint(dictionary.data_, term.size() - shared_size);
+    dictionary.data_.append(term.substr(shared_size));
+    WriteVarint(dictionary.data_, static_cast<uint64_t>(term_id));
+
+    if (static_cast<size_t>(term_id) >= dictionary.term_id_to_ordinal_.size()) {
+        dictionary.term_id_to_ordinal_.resize(static_cast<size_t>(term_id) + 1, kNoOrdinal);
+    }
+    dictionary.term_id_to_ordinal_[term_id] = static_cast<uint32_t>(dictionary.term_count_);
+
+    previous_term_ = term;
+    ++dictionary.term_count_;
+}
+
+TermDictionary TermDictionary::Builder::Build() {
+    dictionary_.data_.shrink_to_fit();
+    dictionary_.block_offsets_.shrink_to_fit();
+    dictionary_.term_id_to_ordinal_.shrink_to_fit();
+
+    TermDictionary dictionary = std::move(dictionary_);
+    dictionary_ = TermDictionary();
+    previous_term_.clear();
+
+    return dictionary;
+}
+
+TermDictionary::Iterator::Iterator(const TermDictionary& dictionary, size_t block)
+    : dictionary_(&dictionary)
+    , ordinal_(block * kBlockSize) {
+    if (block < dictionary.block_offsets_.size()) {
+        position_ = dictionary.block_offsets_[block];
+        Decode();
+    } else {
+        ordinal_ = dictionary.term_count_;
+    }
+}
+
+bool TermDictionary::Iterator::IsEnd() const {
+    return ordinal_ >= dictionary_->term_count_;
+}
+
+std::string_view TermDictionary::Iterator::GetTerm() const {
+    return term_;
+}
+
+int TermDictionary::Iterator::GetTermId() const {
+    return term_id_;
+}
+
+void TermDictionary::Iterator::Next() {
+    if (++ordinal_ < dictionary_->term_count_) {
+        Decode();
+    }
+}
+
+void TermDictionary::Iterator::Decode() {
+    const std::string& data = dictionary_->data_;
+
+    const size_t shared_size = ReadVarint(data, position_);
+    const size_t suffix_size = ReadVarint(data, position_);
+    term_.resize(shared_size);
+    term_.append(data, position_, suffix_size);
+    position_ += suffix_size;
+    term_id_ = static_cast<int>(ReadVarint(data, position_));
+}
@@ -1,12 +1,114 @@
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include "exception_catch.h"
 #include "paginator.h"
+#include "query_protocol.h"
+#include "query_server.h"
 #include "remove_duplicates.h"
 #include "request_queue.h"
 #include "search_server.h"
 #include "test_run.h"
 
+namespace {
+
+void Check(bool condition, const std::string& message) {
+    using namespace std::literals::string_literals;
+
+    if (!condition) {
+        std::cout << "Check failed: "s << message << std::endl;
+        abort();
+    }
+}
+
+// Text of a generated document: each word is in a fixed share of the documents, "dog" twice.
+std::string MakeDocumentText(int seed) {
+    using namespace std::literals::string_literals;
+
+    std::string text = "word"s + std::to_string(seed % 101);
+    if (seed % 2 == 0) {
+        text += " cat"s;
+    }
+    if (seed % 3 == 0) {
+        text += " dog and dog"s;
+    }
+    if (seed % 5 == 0) {
+        text += " fluffy"s;
+    }
+    if (seed % 7 == 0) {
+        text += " tail"s;
+    }
+    // A tag is in a few documents only, so all documents found by it fit into the top ones.
+    text += " tag"s + std::to_string(seed % 1009);
+
+    return text;
+}
+
+// Distinct for generated IDs and not increasing with them, so that top documents come from the whole range.
+int MakeRating(int document_id) {
+    return document_id * 7919 % 10007;
+}
+
+const std::vector<std::string> kGeneratedQueries = {
+    "+cat +dog fluffy", "+cat -dog tail", "cat dog fluffy", "+dog +fluffy -cat word7", "tail -fluffy", "cat dog -tail",
+    "word7 word8 -cat", "tag7", "tag500 -cat",
+};
+
+// Relevances may differ in the last bits when words are scored in another order.
+bool AreSameDocuments(const std::vector<Document>& left, const std::vector<Document>& right) {
+    if (left.size() != right.size()) {
+        return false;
+    }
+
+    for (size_t index = 0; index < left.size(); ++index) {
+        if (left[index].id != right[index].id || left[index].rating != right[index].rating
+            || std::abs(left[index].relevance - right[index].relevance) > 1e-9) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Compares the server with one built from scratch out of the same texts, documents rated with MakeRating.
+void CheckSameAsRebuilt(const SearchServer& search_server, const std::map<int, std::string>& texts,
+                        const std::string& description) {
+    using namespace std::literals::string_literals;
+
+    SearchServer rebuilt_server("and"s, search_server.GetForwardIndexMode());
+    for (const auto& [document_id, text] : texts) {
+        rebuilt_server.AddDocument(document_id, text, DocumentStatus::kActual, {MakeRating(document_id)});
+    }
+
+    Check(search_server.GetDocumentCount() == rebuilt_server.GetDocumentCount(), description + ": document count"s);
+    for (const std::string& query : kGeneratedQueries) {
+        Check(AreSameDocuments(search_server.FindTopDocuments(query), rebuilt_server.FindTopDocuments(query)),
+              description + ": results of "s + query);
+    }
+    for (const auto& [document_id, _] : texts) {
+        Check(search_server.GetWordFrequencies(document_id) == rebuilt_server.GetWordFrequencies(document_id),
+              description + ": word frequencies of document "s + std::to_string(document_id));
+        Check(search_server.MatchDocument("cat dog -tail"s, document_id)
+              == rebuilt_server.MatchDocument("cat dog -tail"s, document_id),
+              description + ": match of document "s + std::to_string(document_id));
+    }
+}
+
+} //namespace
+
 void RunExceptions() {
     using namespace std::literals::string_literals;
 
@@ -135,3 +237,345 @@ void RunRemoveDuplicates() {
 	std::cout << "After duplicates removed: "s << search_server.GetDocumentCount() << std::endl;
 
 }
+
+void RunBoundedRequiredWords() {
+    using namespace std::literals::string_literals;
+
+    SearchServer search_server("and"s);
+
+    for (int document_id = 1; document_id <= 30; ++document_id) {
+        const std::string text = document_id % 3 == 0 ? "cat and dog in collar"s
+                               : document_id % 3 == 1 ? "cat in collar"s : "dog in collar"s;
+        search_server.AddDocument(document_id, text, DocumentStatus::kActual, {document_id % 5});
+    }
+
+    // The budget runs out right after the first required word, the second one must still be applied.
+    const TopDocuments top_documents = search_server.FindTopDocuments("+cat +dog collar"s, DocumentStatus::kActual,
+        QueryBudget{std::chrono::steady_clock::time_point::max(), 10});
+
+    int documents_without_required_words = 0;
+    for (const Document& document : top_documents.documents) {
+        const auto word_frequencies = search_server.GetWordFrequencies(document.id);
+        if (!word_frequencies.count("cat"s) || !word_frequencies.count("dog"s)) {
+            ++documents_without_required_words;
+        }
+    }
+
+    std::cout << "Partial result: "s << std::boolalpha << top_documents.is_partial << std::endl;
+    std::cout << "Documents without a required word: "s << documents_without_required_words << std::endl;
+    Check(documents_without_required_words == 0, "bounded query returns only documents with every required word"s);
+}
+
+void RunResumedQueries() {
+    using namespace std::literals::string_literals;
+
+    SearchServer search_server("and"s);
+    for (int document_id = 1; document_id <= 5000; ++document_id) {
+        search_server.AddDocument(document_id, MakeDocumentText(document_id), DocumentStatus::kActual,
+                                  {MakeRating(document_id)});
+    }
+
+    QueryExecutor query_executor(2);
+    search_server.SetQueryExecutor(&query_executor);
+
+    size_t stopped_query_count = 0;
+    for (const std::string& query : kGeneratedQueries) {
+        const std::vector<Document> documents = search_server.FindTopDocuments(query);
+        Check(!documents.empty(), "documents are found by "s + query);
+
+        // Asynchronous and bounded queries are stepped a block of postings at a time, so their seeds
+        // and merges stop and resume in the middle of a word.
+        Check(AreSameDocuments(search_server.FindTopDocumentsAsync(query).Get(), documents),
+              "async query gives the same results: "s + query);
+        const TopDocuments bounded = search_server.FindTopDocuments(query, DocumentStatus::kActual, QueryBudget{});
+        Check(!bounded.is_partial && AreSameDocuments(bounded.documents, documents),
+              "query resumed after every block gives the same results: "s + query);
+
+        // A query stopped at any point keeps only documents that match it.
+        for (size_t max_postings = 1; ; max_postings += 499) {
+            const TopDocuments partial = search_server.FindTopDocuments(query, DocumentStatus::kActual,
+                QueryBudget{std::chrono::steady_clock::time_point::max(), max_postings});
+            for (const Document& document : partial.documents) {
+                Check(!std::get<0>(search_server.MatchDocument(query, document.id)).empty(),
+                      "stopped query returns only matching documents: "s + query);
+            }
+
+            if (!partial.is_partial) {
+                Check(AreSameDocuments(partial.documents, documents), "query within budget is complete: "s + query);
+                break;
+            }
+            ++stopped_query_count;
+        }
+    }
+
+    std::cout << "Queries checked: "s << kGeneratedQueries.size() << std::endl;
+    std::cout << "Stopped queries checked: "s << stopped_query_count << std::endl;
+}
+
+void RunUpdateDocuments() {
+    using namespace std::literals::string_literals;
+
+    for (const ForwardIndexMode mode : {ForwardIndexMode::kWordFrequencies, ForwardIndexMode::kTermIds}) {
+        SearchServer search_server("and"s, mode);
+        std::map<int, std::string> texts;
+        for (int document_id = 1; document_id <= 3000; ++document_id) {
+            texts[document_id] = MakeDocumentText(document_id);
+            search_server.AddDocument(document_id, texts[document_id], DocumentStatus::kActual,
+                                      {MakeRating(document_id)});
+        }
+
+        // Texts change several times and some documents are removed in between, so postings get erased,
+        // reused and compacted.
+        for (int round = 1; round <= 3; ++round) {
+            for (int document_id = round + 2; document_id <= 3000; document_id += round + 2) {
+                if (texts.count(document_id)) {
+                    texts[document_id] = MakeDocumentText(document_id * 7 + round);
+                    search_server.UpdateDocument(document_id, texts[document_id], DocumentStatus::kActual,
+                                                 {MakeRating(document_id)});
+                }
+            }
+            for (int document_id = round * 11; document_id <= 3000; document_id += 37) {
+                if (texts.erase(document_id)) {
+                    search_server.RemoveDocument(document_id);
+                }
+            }
+        }
+
+        CheckSameAsRebuilt(search_server, texts, "updated documents"s);
+        std::cout << "Updated index matches a rebuilt one"s
+                  << (mode == ForwardIndexMode::kTermIds ? " (term IDs)"s : " (word frequencies)"s)
+                  << ", documents: "s << texts.size() << std::endl;
+    }
+}
+
+void RunReorderDocuments() {
+    using namespace std::literals::string_literals;
+
+    for (const ForwardIndexMode mode : {ForwardIndexMode::kWordFrequencies, ForwardIndexMode::kTermIds}) {
+        SearchServer search_server("and"s, mode);
+        std::map<int, std::string> texts;
+        for (int document_id = 1; document_id <= 3000; ++document_id) {
+            texts[document_id] = MakeDocumentText(document_id);
+            search_server.AddDocument(document_id, texts[document_id], DocumentStatus::kActual,
+                                      {MakeRating(document_id)});
+        }
+        for (int document_id = 13; document_id <= 3000; document_id += 13) {
+            texts.erase(document_id);
+            search_server.RemoveDocument(document_id);
+        }
+
+        std::vector<std::vector<Document>> results;
+        for (const std::string& query : kGeneratedQueries) {
+            results.push_back(search_server.FindTopDocuments(query));
+        }
+
+        search_server.ReorderDocuments();
+
+        for (size_t query = 0; query < kGeneratedQueries.size(); ++query) {
+            Check(AreSameDocuments(search_server.FindTopDocuments(kGeneratedQueries[query]), results[query]),
+                  "reordering keeps results of "s + kGeneratedQueries[query]);
+        }
+        CheckSameAsRebuilt(search_server, texts, "reordered documents"s);
+
+        // Internal IDs are renumbered, documents must still be found, updated and removed by their IDs.
+        for (int document_id = 4; document_id <= 3000; document_id += 4) {
+            if (texts.count(document_id)) {
+                texts[document_id] = MakeDocumentText(document_id + 1);
+                search_server.UpdateDocument(document_id, texts[document_id], DocumentStatus::kActual,
+                                             {MakeRating(document_id)});
+            }
+        }
+        for (int document_id = 10; document_id <= 3000; document_id += 10) {
+            if (texts.erase(document_id)) {
+                search_server.RemoveDocument(document_id);
+            }
+        }
+        texts[3001] = MakeDocumentText(3001);
+        search_server.AddDocument(3001, texts[3001], DocumentStatus::kActual, {MakeRating(3001)});
+
+        CheckSameAsRebuilt(search_server, texts, "documents changed after reordering"s);
+        std::cout << "Reordered index matches a rebuilt one"s
+                  << (mode == ForwardIndexMode::kTermIds ? " (term IDs)"s : " (word frequencies)"s)
+                  << ", documents: "s << texts.size() << std::endl;
+    }
+}
+
+void RunTypoExpansion() {
+    using namespace std::literals::string_literals;
+
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "fluffy cat with collar"s, DocumentStatus::kActual, {3});
+    search_server.AddDocument(2, "curly dog and collar"s, DocumentStatus::kActual, {2});
+    search_server.AddDocument(3, "big cap"s, DocumentStatus::kActual, {1});
+    search_server.AddDocument(4, "fluffy dog"s, DocumentStatus::kActual, {4});
+
+    Check(search_server.FindTopDocuments("colar"s).empty(), "typo tolerance is off by default"s);
+
+    search_server.SetMaxTypoDistance(1);
+    const std::vector<Document> one_edit = search_server.FindTopDocuments("colar"s);
+    Check(one_edit.size() == 2, "one edit away: colar finds collar"s);
+    Check(search_server.FindTopDocuments("colr"s).empty(), "two edits away are not found with distance 1"s);
+    Check(search_server.FindTopDocuments("cat"s).size() == 1, "indexed words are not expanded: cat does not find cap"s);
+
+    // Each edit halves the relevance of the word found in place of the misspelled one.
+    const std::vector<Document> exact = search_server.FindTopDocuments("collar"s);
+    Check(exact.size() == one_edit.size() && std::abs(exact[0].relevance / 2 - one_edit[0].relevance) < 1e-9,
+          "typo words count half"s);
+
+    search_server.SetMaxTypoDistance(2);
+    const std::vector<Document> two_edits = search_server.FindTopDocuments("colr"s);
+    Check(two_edits.size() == 2 && std::abs(exact[0].relevance / 4 - two_edits[0].relevance) < 1e-9,
+          "two edits away: colr finds collar with a quarter of the relevance"s);
+
+    search_server.SetMaxTypoDistance(5);
+    Check(AreSameDocuments(search_server.FindTopDocuments("colr"s), two_edits), "distances above 2 are taken as 2"s);
+
+    bool is_rejected = false;
+    try {
+        search_server.SetMaxTypoDistance(-1);
+    } catch (const std::invalid_argument&) {
+        is_rejected = true;
+    }
+    Check(is_rejected, "negative typo distance is rejected"s);
+
+    std::cout << "Found by \"colar\" one edit away: "s << one_edit.size() << std::endl;
+    std::cout << "Found by \"colr\" two edits away: "s << two_edits.size() << std::endl;
+}
+
+void RunQueryProtocol() {
+    using namespace std::literals::string_literals;
+
+#if defined(__linux__)
+    using query_protocol::Operation;
+
+    SearchServer search_server("and in"s);
+    QueryServer query_server(search_server, QueryServerOptions{});
+    std::thread server_thread([&query_server] {
+        query_server.Run();
+    });
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(query_server.GetPort());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    const int client_socket = socket(AF_INET, SOCK_STREAM, 0);
+    Check(connect(client_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0, "connect"s);
+
+    const auto send_all = [client_socket](std::string_view data) {
+        while (!data.empty()) {
+            const ssize_t sent = send(client_socket, data.data(), data.size(), MSG_NOSIGNAL);
+            Check(sent > 0, "send"s);
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+    };
+
+    std::string input;
+    // Payload of the next response frame, nothing if the server closed the connection.
+    const auto read_response = [client_socket, &input]() -> std::optional<std::string> {
+        while (true) {
+            if (const std::optional<size_t> payload_size = query_protocol::PeekFrame(input)) {
+                std::string payload = input.substr(query_protocol::kFrameHeaderSize, *payload_size);
+                input.erase(0, query_protocol::kFrameHeaderSize + *payload_size);
+                return payload;
+            }
+
+            char buffer[4096];
+            const ssize_t received = recv(client_socket, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                return std::nullopt;
+            }
+            input.append(buffer, static_cast<size_t>(received));
+        }
+    };
+
+    const auto frame = [](const query_protocol::Request& request) {
+        std::string output;
+        query_protocol::AppendFrame(output, query_protocol::EncodeRequest(request));
+        return output;
+    };
+
+    const auto is_error = [](const std::string& payload) {
+        try {
+            query_protocol::CheckResponse(payload);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+
+    // A request split inside the header and inside the payload arrives in several reads.
+    const std::string add_request = frame({Operation::kAddDocument, 1, DocumentStatus::kActual, {4, 5}, "cat in collar"s});
+    send_all(std::string_view(add_request).substr(0, 2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    send_all(std::string_view(add_request).substr(2, 7));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    send_all(std::string_view(add_request).substr(9));
+    std::optional<std::string> response = read_response();
+    Check(response && !is_error(*response), "split request is answered with Ok"s);
+
+    // Pipelined mutations and queries take effect in request order. Slow queries in front of every add
+    // hold the index, so a query sent after the add could otherwise get to it first.
+    for (int document_id = 1000; document_id < 21000; ++document_id) {
+        search_server.AddDocument(document_id, "common filler"s, DocumentStatus::kActual, {1});
+    }
+
+    std::string pipeline;
+    for (int document_id = 100; document_id < 110; ++document_id) {
+        const std::string word = "word"s + std::to_string(document_id);
+        for (int slow_query = 0; slow_query < 3; ++slow_query) {
+            pipeline += frame({Operation::kFindTopDocuments, 0, DocumentStatus::kActual, {}, "common filler"s});
+        }
+        pipeline += frame({Operation::kAddDocument, document_id, DocumentStatus::kActual, {1}, word});
+        pipeline += frame({Operation::kFindTopDocuments, 0, DocumentStatus::kActual, {}, word});
+        pipeline += frame({Operation::kRemoveDocument, document_id, DocumentStatus::kActual, {}, ""s});
+        pipeline += frame({Operation::kFindTopDocuments, 0, DocumentStatus::kActual, {}, word});
+    }
+    send_all(pipeline);
+    for (int document_id = 100; document_id < 110; ++document_id) {
+        for (int slow_query = 0; slow_query < 3; ++slow_query) {
+            response = read_response();
+            Check(query_protocol::DecodeDocuments(response.value()).size() == 5, "slow query finds documents"s);
+        }
+        response = read_response();
+        Check(response && !is_error(*response), "pipelined add is answered with Ok"s);
+        response = read_response();
+        const std::vector<Document> added = query_protocol::DecodeDocuments(response.value());
+        Check(added.size() == 1 && added[0].id == document_id, "query after add finds the document"s);
+        response = read_response();
+        Check(response && !is_error(*response), "pipelined remove is answered with Ok"s);
+        response = read_response();
+        Check(query_protocol::DecodeDocuments(response.value()).empty(), "query after remove finds nothing"s);
+    }
+
+    // Bad requests get error replies and leave the connection usable.
+    std::string bad_requests = frame({Operation::kFindTopDocuments, 0, DocumentStatus::kActual, {}, "cat -"s});
+    bad_requests += frame({Operation::kAddDocument, 2, DocumentStatus::kActual, {1}, "and in"s});
+    query_protocol::AppendFrame(bad_requests, "\x63"s);
+    bad_requests += frame({Operation::kMatchDocument, 1, DocumentStatus::kActual, {}, "cat dog"s});
+    send_all(bad_requests);
+    for (const std::string& request_name : {"malformed query"s, "document of stop words"s, "unknown operation"s}) {
+        response = read_response();
+        Check(response && is_error(*response), request_name + " is answered with an error"s);
+    }
+    response = read_response();
+    const auto [words, status] = query_protocol::DecodeMatchResult(response.value());
+    Check(words == std::vector<std::string>{"cat"s} && status == DocumentStatus::kActual,
+          "connection works after errors"s);
+
+    // A frame over the size limit closes the connection.
+    std::string oversized_frame;
+    oversized_frame.push_back(static_cast<char>(0x7F));
+    oversized_frame.append(3, static_cast<char>(0xFF));
+    send_all(oversized_frame);
+    Check(!read_response(), "oversized frame closes the connection"s);
+
+    close(client_socket);
+    query_server.Stop();
+    server_thread.join();
+
+    std::cout << "Protocol checks passed, documents left: "s << search_server.GetDocumentCount() << std::endl;
+#else
+    std::cout << "Protocol checks need Linux"s << std::endl;
+#endif
+}
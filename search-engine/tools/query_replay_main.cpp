@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "corpus_loader.h"
+#include "query_log.h"
+#include "search_server.h"
+
+using namespace std::literals::string_literals;
+
+// Replays a query log recorded by RequestQueue against a SearchServer loaded from a corpus snapshot.
+//
+// The load is open-loop: every request has an intended start time fixed in advance (either the recorded
+// arrival times or a target rate), and its latency is measured from that time rather than from the moment
+// a worker got to it. A stalled server therefore shows up as queueing delay in the latency of the requests
+// behind it instead of silently lowering the offered load (coordinated omission).
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ReplayOptions {
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // Target rates to sweep, the recorded arrival times are used if empty.
+    std::vector<double> target_rates;
+    double duration_seconds = 10;
+    double speed = 1;
+    bool is_poisson = false;
+    bool is_printing_timeline = false;
+};
+
+struct RunResult {
+    std::vector<Clock::duration> latencies;
+    // Completion time of every request relative to the start of the run.
+    std::vector<Clock::duration> completion_times;
+    size_t error_count = 0;
+};
+
+void PrintUsage() {
+    std::cerr << "Usage: query_replay --log FILE [--corpus FILE] [--corpus-format tsv|jsonl] [--stop-words \"w1 w2\"]"s
+     << " [--threads N] [--qps R1,R2,...] [--duration SECONDS] [--arrivals uniform|poisson] [--speed X]"s
+     << " [--timeline on|off]"s << std::endl;
+}
+
+std::vector<double> ParseRates(const std::string& value) {
+    std::vector<double> rates;
+    std::istringstream input(value);
+    std::string rate;
+    while (std::getline(input, rate, ',')) {
+        rates.push_back(std::stod(rate));
+        if (rates.back() <= 0) {
+            throw std::invalid_argument("Target rate must be positive."s);
+        }
+    }
+
+    return rates;
+}
+
+std::vector<query_log::Record> ReadLog(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::invalid_argument("Cannot open "s + path);
+    }
+
+    query_log::Reader reader(input);
+    std::vector<query_log::Record> records;
+    while (std::optional<query_log::Record> record = reader.Read()) {
+        records.push_back(std::move(*record));
+    }
+
+    if (records.empty()) {
+        throw std::invalid_argument("Query log is empty."s);
+    }
+
+    return records;
+}
+
+// Intended start times of the recorded requests, relative to the first one and divided by speed.
+std::vector<Clock::duration> ScheduleRecorded(const std::vector<query_log::Record>& records, double speed) {
+    std::vector<Clock::duration> schedule;
+    schedule.reserve(records.size());
+    for (const query_log::Record& record : records) {
+        const double offset_us = std::max<int64_t>(0, record.timestamp_us - records.front().timestamp_us) / speed;
+        schedule.push_back(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(offset_us)));
+    }
+
+    return schedule;
+}
+
+// Intended start times of requests arriving at rate per second for duration_seconds.
+std::vector<Clock::duration> ScheduleAtRate(double rate, double duration_seconds, bool is_poisson) {
+    std::mt19937_64 generator(42);
+    std::exponential_distribution<double> interval(rate);
+
+    std::vector<Clock::duration> schedule;
+    const size_t request_count = std::max<size_t>(1, static_cast<size_t>(std::ceil(rate * duration_seconds)));
+    schedule.reserve(request_count);
+
+    double offset_seconds = 0;
+    for (size_t index = 0; index < request_count; ++index) {
+        schedule.push_back(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset_seconds)));
+        offset_seconds += is_poisson ? interval(generator) : 1 / rate;
+    }
+
+    return schedule;
+}
+
+// Request i of the schedule runs record i modulo the log size.
+RunResult Run(const SearchServer& search_server, const std::vector<query_log::Record>& records,
+              const std::vector<Clock::duration>& schedule, size_t thread_count) {
+    RunResult result;
+    result.latencies.resize(schedule.size());
+    result.completion_times.resize(schedule.size());
+
+    std::atomic<size_t> next_request = 0;
+    std::atomic<size_t> error_count = 0;
+    const Clock::time_point start_time = Clock::now();
+
+    const auto worker = [&] {
+        for (size_t index = next_request++; index < schedule.size(); index = next_request++) {
+            const Clock::time_point intended_time = start_time + schedule[index];
+            std::this_thread::sleep_until(intended_time);
+
+            const query_log::Record& record = records[index % records.size()];
+            const DocumentStatus status = record.filter_key < kDocumentStatusCount
+                ? static_cast<DocumentStatus>(record.filter_key) : DocumentStatus::kActual;
+            try {
+                [[maybe_unused]] const auto documents = search_server.FindTopDocuments(record.raw_query, status);
+            } catch (const std::exception&) {
+                ++error_count;
+            }
+
+            const Clock::time_point completion_time = Clock::now();
+            result.latencies[index] = completion_time - intended_time;
+            result.completion_times[index] = completion_time - start_time;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t index = 0; index < thread_count; ++index) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    result.error_count = error_count;
+    return result;
+}
+
+double ToMilliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Nearest-rank percentile of sorted latencies.
+Clock::duration GetPercentile(const std::vector<Clock::duration>& sorted_latencies, double percentile) {
+    const size_t rank = static_cast<size_t>(std::ceil(percentile / 100 * sorted_latencies.size()));
+    return sorted_latencies[std::clamp<size_t>(rank, 1, sorted_latencies.size()) - 1];
+}
+
+void PrintLatencies(std::vector<Clock::duration> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    for (const double percentile : {50.0, 90.0, 99.0, 99.9}) {
+        std::cout << std::setw(10) << ToMilliseconds(GetPercentile(latencies, percentile));
+    }
+    std::cout << std::setw(10) << ToMilliseconds(latencies.back());
+}
+
+void PrintHeader(const std::string& first_column) {
+    std::cout << std::setw(10) << first_column << std::setw(10) << "done/s"s << std::setw(10) << "p50 ms"s
+              << std::setw(10) << "p90 ms"s << std::setw(10) << "p99 ms"s << std::setw(10) << "p99.9 ms"s
+              << std::setw(10) << "max ms"s << std::endl;
+}
+
+// Completed requests and latencies of the requests completed within every second of the run.
+void PrintTimeline(const RunResult& result) {
+    const Clock::duration run_time = *std::max_element(result.completion_times.begin(), result.completion_times.end());
+    const size_t second_count = static_cast<size_t>(std::chrono::duration_cast<std::chrono::seconds>(run_time).count()) + 1;
+
+    std::vector<std::vector<Clock::duration>> latencies_by_second(second_count);
+    for (size_t index = 0; index < result.latencies.size(); ++index) {
+        const auto second = std::chrono::duration_cast<std::chrono::seconds>(result.completion_times[index]).count();
+        latencies_by_second[static_cast<size_t>(second)].push_back(result.latencies[index]);
+    }
+
+    PrintHeader("second"s);
+    for (size_t second = 0; second < second_count; ++second) {
+        if (latencies_by_second[second].empty()) {
+            continue;
+        }
+        std::cout << std::setw(10) << second << std::setw(10) << latencies_by_second[second].size();
+        PrintLatencies(std::move(latencies_by_second[second]));
+        std::cout << std::endl;
+    }
+}
+
+// One line of the throughput curve: offered rate, achieved rate and latency percentiles.
+void PrintRun(const std::string& label, const RunResult& result) {
+    const Clock::duration run_time = *std::max_element(result.completion_times.begin(), result.completion_times.end());
+    const double achieved_rate = result.latencies.size() / std::max(1e-9, std::chrono::duration<double>(run_time).count());
+
+    std::cout << std::setw(10) << label << std::setw(10) << std::llround(achieved_rate);
+    PrintLatencies(result.latencies);
+    if (result.error_count > 0) {
+        std::cout << "  ("s << result.error_count << " failed)"s;
+    }
+    std::cout << std::endl;
+}
+
+} //namespace
+
+int main(int argc, char* argv[]) {
+    std::string log_path;
+    std::string stop_words;
+    std::string corpus_path;
+    corpus_loader::LoaderOptions loader_options;
+    ReplayOptions options;
+
+    try {
+        for (int index = 1; index < argc; ++index) {
+            const std::string argument = argv[index];
+            if (index + 1 >= argc) {
+                PrintUsage();
+                return 1;
+            }
+
+            const std::string value = argv[++index];
+            if (argument == "--log"s) {
+                log_path = value;
+            } else if (argument == "--corpus"s) {
+                corpus_path = value;
+            } else if (argument == "--corpus-format"s && (value == "tsv"s || value == "jsonl"s)) {
+                loader_options.format = value == "tsv"s ? corpus_loader::CorpusFormat::kTsv
+                                                        : corpus_loader::CorpusFormat::kJsonLines;
+            } else if (argument == "--stop-words"s) {
+                stop_words = value;
+            } else if (argument == "--threads"s) {
+                options.thread_count = std::max<size_t>(1, std::stoul(value));
+            } else if (argument == "--qps"s) {
+                options.target_rates = ParseRates(value);
+            } else if (argument == "--duration"s) {
+                options.duration_seconds = std::stod(value);
+            } else if (argument == "--arrivals"s && (value == "uniform"s || value == "poisson"s)) {
+                options.is_poisson = value == "poisson"s;
+            } else if (argument == "--speed"s && std::stod(value) > 0) {
+                options.speed = std::stod(value);
+            } else if (argument == "--timeline"s && (value == "on"s || value == "off"s)) {
+                options.is_printing_timeline = value == "on"s;
+            } else {
+                PrintUsage();
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (log_path.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    try {
+        const std::vector<query_log::Record> records = ReadLog(log_path);
+        std::cout << "query log: "s << records.size() << " requests"s << std::endl;
+
+        SearchServer search_server(stop_words);
+        if (!corpus_path.empty()) {
+            loader_options.parse_thread_count = options.thread_count;
+            loader_options.tokenize_thread_count = options.thread_count;
+            std::cout << corpus_loader::LoadCorpus(corpus_path, search_server, loader_options);
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+
+        if (options.target_rates.empty()) {
+            const RunResult result = Run(search_server, records, ScheduleRecorded(records, options.speed),
+                                         options.thread_count);
+            PrintHeader("speed"s);
+            std::ostringstream label;
+            label << options.speed << 'x';
+            PrintRun(label.str(), result);
+            if (options.is_printing_timeline) {
+                PrintTimeline(result);
+            }
+            return 0;
+        }
+
+        PrintHeader("qps"s);
+        for (const double rate : options.target_rates) {
+            const RunResult result = Run(search_server, records,
+                                         ScheduleAtRate(rate, options.duration_seconds, options.is_poisson),
+                                         options.thread_count);
+            PrintRun(std::to_string(std::llround(rate)), result);
+            if (options.is_printing_timeline) {
+                PrintTimeline(result);
+                PrintHeader("qps"s);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "query_replay: "s << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "corpus_loader.h"
+#include "log_duration.h"
+#include "query_server.h"
+#include "search_server.h"
+
+using namespace std::literals::string_literals;
+
+namespace {
+
+QueryServer* running_server = nullptr;
+
+void HandleStopSignal(int) {
+    if (running_server != nullptr) {
+        running_server->Stop();
+    }
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: search_server [--address A] [--port N] [--threads N] [--pipeline N] [--stop-words \"w1 w2\"]"s
+     << " [--corpus FILE] [--corpus-format tsv|jsonl] [--forward-index words|term-ids]"s
+     << " [--reorder on|off] [--score-precision double|float]"s << std::endl;
+}
+
+} //namespace
+
+int main(int argc, char* argv[]) {
+    QueryServerOptions options;
+    options.worker_count = std::max(1u, std::thread::hardware_concurrency());
+    std::string stop_words;
+    std::string corpus_path;
+    corpus_loader::LoaderOptions loader_options;
+    ForwardIndexMode forward_index_mode = ForwardIndexMode::kWordFrequencies;
+    bool is_reordering = false;
+    ScorePrecision score_precision = ScorePrecision::kDouble;
+
+    for (int index = 1; index < argc; ++index) {
+        const std::string argument = argv[index];
+        if (index + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+
+        const std::string value = argv[++index];
+        if (argument == "--address"s) {
+            options.address = value;
+        } else if (argument == "--port"s) {
+            options.port = static_cast<uint16_t>(std::stoi(value));
+        } else if (argument == "--threads"s) {
+            options.worker_count = static_cast<size_t>(std::stoul(value));
+        } else if (argument == "--pipeline"s) {
+            options.max_pipelined_requests = static_cast<size_t>(std::stoul(value));
+        } else if (argument == "--stop-words"s) {
+            stop_words = value;
+        } else if (argument == "--corpus"s) {
+            corpus_path = value;
+        } else if (argument == "--corpus-format"s && (value == "tsv"s || value == "jsonl"s)) {
+            loader_options.format = value == "tsv"s ? corpus_loader::CorpusFormat::kTsv
+                                                    : corpus_loader::CorpusFormat::kJsonLines;
+        } else if (argument == "--forward-index"s && (value == "words"s || value == "term-ids"s)) {
+            forward_index_mode = value == "words"s ? ForwardIndexMode::kWordFrequencies : ForwardIndexMode::kTermIds;
+        } else if (argument == "--reorder"s && (value == "on"s || value == "off"s)) {
+            is_reordering = value == "on"s;
+        } else if (argument == "--score-precision"s && (value == "double"s || value == "float"s)) {
+            score_precision = value == "double"s ? ScorePrecision::kDouble : ScorePrecision::kFloat;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    try {
+        SearchServer search_server(stop_words, forward_index_mode);
+        search_server.SetScorePrecision(score_precision);
+
+        if (!corpus_path.empty()) {
+            loader_options.parse_thread_count = options.worker_count;
+            loader_options.tokenize_thread_count = options.worker_count;
+            std::cout << corpus_loader::LoadCorpus(corpus_path, search_server, loader_options);
+            if (is_reordering) {
+                LOG_DURATION_STREAM("reorder documents"s, std::cout);
+                search_server.ReorderDocuments();
+            }
+            std::cout << "index memory: "s << search_server.GetMemoryUsage();
+        }
+
+        QueryServer query_server(search_server, options);
+
+        running_server = &query_server;
+        std::signal(SIGINT, HandleStopSignal);
+        std::signal(SIGTERM, HandleStopSignal);
+
+        std::cout << "Listening on "s << options.address << ":"s << query_server.GetPort() << std::endl;
+        query_server.Run();
+        running_server = nullptr;
+    } catch (const std::exception& e) {
+        std::cerr << "search_server: "s << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}